@@ -24,6 +24,10 @@
  */
 #include <mpi.h>
 #include <iostream>
+#include <string>
+#include <sstream>
+#include <vector>
+#include <algorithm>
 #include <ctime>
 #include <stdlib.h>
 #include <cassert>
@@ -34,21 +38,25 @@
 #include "coreneuron_1.0/event_passing/queueing/thread.h"
 #include "coreneuron_1.0/event_passing/environment/generator.h"
 #include "coreneuron_1.0/event_passing/environment/event_generators.hpp"
+#include "coreneuron_1.0/event_passing/environment/stream_generator.h"
 #include "coreneuron_1.0/event_passing/environment/presyn_maker.h"
 #include "coreneuron_1.0/event_passing/spike/spike_interface.h"
 #include "coreneuron_1.0/event_passing/spike/algos.hpp"
+#include "coreneuron_1.0/event_passing/spike/nonblocking.hpp"
 #include "coreneuron_1.0/event_passing/spike/distributed.hpp"
 #include "utils/storage/neuromapp_data.h"
+#include "utils/mpi/timeline.h"
 
 // Get OMP header if available
 #include "utils/omp/compatibility.h"
 
 
 int main(int argc, char* argv[]) {
-    assert(argc == 8);
+    assert(argc == 18);
 
     MPI_Init(NULL, NULL);
     MPI_Datatype mpi_spike = create_spike_type();
+    MPI_Datatype mpi_compact = create_compact_spike_type();
     int rank, size;
     MPI_Comm_rank(MPI_COMM_WORLD, &rank);
     MPI_Comm_size(MPI_COMM_WORLD, &size);
@@ -60,35 +68,147 @@ int main(int argc, char* argv[]) {
     int nSpikes = atoi(argv[5]);
     int mindelay = atoi(argv[6]);
     bool algebra = atoi(argv[7]);
+    queueing::queue_type qtype = queueing::binary_heap;
+    if(!queueing::queue_type_from_string(argv[8], qtype) && rank == 0)
+        std::cout<<"unknown queue "<<argv[8]<<", binary heap used"<<std::endl;
+    std::string trace = argv[9]; // prefix of the trace files, none if no trace
+    queueing::inter_thread_type ite = queueing::mutex_ite;
+    if(!queueing::inter_thread_type_from_string(argv[10], ite) && rank == 0)
+        std::cout<<"unknown inter thread mode "<<argv[10]<<", mutex used"<<std::endl;
+    std::string exchange = argv[11]; // blocking or nonblocking (overlapped) spike exchange
+    bool nonblocking = (exchange == "nonblocking");
+    bool compact = (std::string(argv[12]) == "compact"); // 8 bytes wire format
+    queueing::schedule_type schedule = queueing::static_schedule;
+    if(!queueing::schedule_type_from_string(argv[13], schedule) && rank == 0)
+        std::cout<<"unknown schedule "<<argv[13]<<", static used"<<std::endl;
+    std::string gen = argv[14]; // kai, parallel (OpenMP) or stream (lazy) event generation
+    bool stream = (gen == "stream");
+    std::string threshold = argv[15]; // none, or the voltage (mV) of the spike detection
+    bool detect = (threshold != "none");
+    std::string timeline = argv[16]; // prefix of the chrome trace files, none if no timeline
+    std::string cost = argv[17]; // none (contiguous), lognormal or a file of per gid costs (balanced)
+    if(detect && !algebra){
+        if(rank == 0)
+            std::cout<<"the spike detection needs the linear algebra, algebra on"<<std::endl;
+        algebra = true;
+    }
 
     struct timeval start, end;
 
-    int cellsper = ncells / size;
-
     //create environment
     environment::event_generator generator(ngroups);
 
     double mean = static_cast<double>(simtime) / static_cast<double>(nSpikes);
     double lambda = 1.0 / static_cast<double>(mean * size);
 
-    environment::continousdistribution neuro_dist(size, rank, ncells);
+    std::vector<double> costs;
+    environment::neurondistribution* distribution =
+        environment::make_distribution(cost, size, rank, ncells, costs);
+    if(!distribution){
+        if(rank == 0)
+            std::cout<<"cannot read "<<ncells<<" cell costs from "<<cost<<std::endl;
+        MPI_Finalize();
+        return 1;
+    }
+    environment::neurondistribution& neuro_dist = *distribution;
+    if(!costs.empty()){
+        //max over mean of the cost of the ranks
+        double load[2] = {environment::local_cost(neuro_dist, costs), 0.};
+        load[1] = load[0];
+        MPI_Allreduce(MPI_IN_PLACE, &load[0], 1, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+        MPI_Allreduce(MPI_IN_PLACE, &load[1], 1, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+        if(rank == 0)
+            std::cout<<"cost imbalance: "<<load[0]*size/load[1]<<" balanced, "
+                     <<environment::contiguous_imbalance(size, costs)<<" contiguous"<<std::endl;
+    }
 
-    environment::generate_events_kai(generator.begin(),
-                              simtime, ngroups, rank, size, lambda, &neuro_dist);
+    double gen_time = MPI_Wtime();
+    if(gen == "parallel"){
+        environment::generate_events_parallel(generator.begin(),
+                                  simtime, ngroups, rank, size, lambda, &neuro_dist, mindelay);
+    }
+    else if(!stream){
+        environment::generate_events_kai(generator.begin(),
+                                  simtime, ngroups, rank, size, lambda, &neuro_dist);
+    }
+    gen_time = MPI_Wtime() - gen_time;
+    MPI_Allreduce(MPI_IN_PLACE, &gen_time, 1, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+    if(rank == 0)
+        std::cout<<"generation time: "<<gen_time*1000.<<" ms"<<std::endl;
+    //the events of a window are generated when a group reaches it
+    environment::stream_generator streamer(ngroups, simtime, rank, size, lambda,
+                                           &neuro_dist, mindelay);
 
     environment::presyn_maker presyns(fanin);
     presyns(rank, &neuro_dist);
+    double presyn_mb = presyns.memory()/(1024.*1024.);
+    MPI_Allreduce(MPI_IN_PLACE, &presyn_mb, 1, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+    if(rank == 0)
+        std::cout<<"presyn memory: "<<presyn_mb<<" MB (max per rank)"<<std::endl;
     spike::spike_interface s_interface(size);
 
     //run simulation
-    MPI_Comm neighborhood = create_dist_graph(presyns, cellsper);
-    queueing::pool pl(algebra, ngroups, mindelay, rank, s_interface);
+    double setup = MPI_Wtime();
+    MPI_Comm neighborhood = create_dist_graph_scalable(presyns, &neuro_dist);
+    setup = MPI_Wtime() - setup;
+    MPI_Allreduce(MPI_IN_PLACE, &setup, 1, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+    if(rank == 0)
+        std::cout<<"graph setup time: "<<setup*1000.<<" ms"<<std::endl;
+    //the overlapped exchange filters the spikes of a fixed step after the
+    //next one, two fixed steps of mindelay/2 keep them within mindelay
+    const int interval = nonblocking ? std::max(mindelay/2, 1) : mindelay;
+    queueing::pool pl(algebra, ngroups, interval, rank, s_interface, qtype, ite, schedule);
+    if(trace != "none")
+        pl.record_trace(true);
+    mapp::timeline* tl = NULL;
+    if(timeline != "none"){
+        tl = new mapp::timeline(pl.get_nthreads());
+        pl.set_timeline(tl);
+    }
+    if(detect){
+        //the local cells spike when their compartment crosses the threshold
+        std::vector<int> gids(neuro_dist.getlocalcells());
+        for(int i = 0; i < gids.size(); ++i)
+            gids[i] = neuro_dist.local2global(i);
+        int watched = pl.watch(gids, atof(threshold.c_str()));
+        MPI_Allreduce(MPI_IN_PLACE, &watched, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+        if(rank == 0)
+            std::cout<<"threshold detection on "<<watched<<" cells, "<<threshold<<" mV"<<std::endl;
+    }
+    int indegree, outdegree, weighted;
+    MPI_Dist_graph_neighbors_count(neighborhood, &indegree, &outdegree, &weighted);
+    nonblocking_exchange nb(neighborhood, indegree, true);
+    nb.compact_ = compact;
     gettimeofday(&start, NULL);
     while(pl.get_time() <= simtime){
-        pl.fixed_step(generator, presyns);
-        distributed_spike(s_interface, mpi_spike, neighborhood);
+        if(stream)
+            pl.fixed_step(streamer, presyns);
+        else
+            pl.fixed_step(generator, presyns);
+        //the spikes of the interval, the same on every rank
+        double t0_window = pl.get_time() - interval;
+        double t_exchange = omp_get_wtime();
+        if(nonblocking){
+            nonblocking_spike(s_interface, compact ? mpi_compact : mpi_spike, nb, t0_window);
+        }
+        else{
+            double t0 = MPI_Wtime();
+            if(compact)
+                compact_distributed_spike(s_interface, mpi_compact, neighborhood, t0_window);
+            else
+                distributed_spike(s_interface, mpi_spike, neighborhood);
+            nb.exposed_time_ += MPI_Wtime() - t0;
+        }
+        double t_filter = omp_get_wtime();
         pl.filter(presyns);
+        if(tl){
+            tl->record(0, mapp::exchange_phase, t_exchange, t_filter);
+            tl->record(0, mapp::filter_phase, t_filter, omp_get_wtime());
+        }
     }
+    //the spikes of the last interval
+    nonblocking_spike_wait(s_interface, nb);
+    pl.filter(presyns);
     gettimeofday(&end, NULL);
 
     long long diff_ms = (1000 * (end.tv_sec - start.tv_sec))
@@ -98,11 +218,55 @@ int main(int argc, char* argv[]) {
         std::cout<<"run time: "<<diff_ms<<" ms"<<std::endl;
     }
 
+    if(trace != "none" && !pl.write_trace(trace))
+        std::cout<<"Rank: "<<rank<<" could not write the trace "<<trace<<std::endl;
+
+    //idle time of every thread in fixed_step, max over the ranks
+    std::vector<double> idle(pl.get_nthreads());
+    for(int i = 0; i < idle.size(); ++i)
+        idle[i] = pl.idle_fraction(i);
+    MPI_Allreduce(MPI_IN_PLACE, &idle[0], idle.size(), MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+    if(rank == 0){
+        for(int i = 0; i < idle.size(); ++i)
+            std::cout<<"thread "<<i<<" idle: "<<100.*idle[i]<<" % (max over ranks)"<<std::endl;
+    }
+
+    if(tl){
+        std::stringstream file;
+        file << timeline << "_" << rank << ".json";
+        if(!tl->write_chrome(file.str(), rank))
+            std::cout<<"Rank: "<<rank<<" could not write the timeline "<<file.str()<<std::endl;
+        tl->summary(MPI_COMM_WORLD);
+        pl.set_timeline(NULL);
+        delete tl;
+    }
+
     pl.accumulate_stats();
     accumulate_stats(s_interface);
+    if(!nonblocking)
+        nb.in_flight_time_ = nb.exposed_time_;
+    report_exchange(nb);
+    if(detect){
+        //compute and detection (summed over the groups) against the exchange
+        int detected;
+        double times[4];
+        pl.step_stats(detected, times[1], times[2]);
+        times[0] = pl.get_step_time();
+        times[3] = nb.exposed_time_;
+        MPI_Allreduce(MPI_IN_PLACE, &detected, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+        MPI_Allreduce(MPI_IN_PLACE, times, 4, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+        if(rank == 0){
+            std::cout<<"detected spikes: "<<detected<<std::endl;
+            std::cout<<"fixed step: "<<times[0]*1000.<<" ms, compute: "<<times[1]*1000.
+                     <<" ms, detection: "<<times[2]*1000.<<" ms (summed over the groups), exchange: "
+                     <<times[3]*1000.<<" ms (max over ranks)"<<std::endl;
+        }
+    }
 
     MPI_Comm_free(&neighborhood);
+    delete distribution;
     MPI_Type_free(&mpi_spike);
+    MPI_Type_free(&mpi_compact);
     MPI_Finalize();
     return 0;
 }
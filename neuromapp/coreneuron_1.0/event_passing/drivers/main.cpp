@@ -24,13 +24,18 @@
  */
 
 #include <iostream>
+#include <iomanip>
 #include <string>
 #include <sstream>
+#include <numeric>
 #include <boost/program_options.hpp>
 #include <stdlib.h>
 
 #include "utils/error.h"
 #include "neuromapp/utils/mpi/mpi_helper.h"
+#include "coreneuron_1.0/event_passing/queueing/queue.h"
+#include "coreneuron_1.0/event_passing/queueing/options.h"
+#include "coreneuron_1.0/event_passing/spike/network_model.h"
 
 /** namespace alias for boost::program_options **/
 namespace po = boost::program_options;
@@ -64,6 +69,44 @@ int event_help(int argc, char* const argv[], po::variables_map& vm){
     "Total number of spikes produced by the simulation")
     ("mindelay", po::value<size_t>()->default_value(3),
     "the number of timesteps per fixed step function")
+    ("queue", po::value<std::string>()->default_value("heap"),
+    "the priority queue of the cell groups: heap, radix, sptq, bin or ladder")
+    ("trace", po::value<std::string>()->default_value("none"),
+    "record the priority queues, every cell group writes $trace_rank_group.trace")
+    ("ite", po::value<std::string>()->default_value("mutex"),
+    "the inter thread events between cell groups: mutex (locked buffer per group) or spsc (lock free ring per pair)")
+    ("exchange", po::value<std::string>()->default_value("blocking"),
+    "the spike exchange: blocking, nonblocking (overlapped with the next fixed step of mindelay/2 steps, the spikes still arrive within mindelay) sparse (only to the ranks with targets) hierarchical (one allgatherv per shared memory node) or multiple (MPI_THREAD_MULTIPLE, every thread exchanges the spikes of its cell groups on its own communicator as soon as they are stepped), not with --distributed")
+    ("wire", po::value<std::string>()->default_value("event"),
+    "the spike wire format: event (int + double) or compact (8 bytes, gid + time in the exchange window)")
+    ("schedule", po::value<std::string>()->default_value("static"),
+    "the scheduling of the cell groups on the threads: static (round robin), dynamic (first come first served, the most expensive groups first) or balanced (measured cost assignment every 10 fixed steps + work stealing)")
+    ("generator", po::value<std::string>()->default_value("kai"),
+    "the spike generation: kai (every event of the run generated before the run), parallel (the same, the cell groups in parallel with counter based random numbers) or stream (generated window by window when a cell group reaches it, counter based random numbers)")
+    ("threshold", po::value<std::string>()->default_value("none"),
+    "none, or the voltage (mV) of the spike detection: the cells also spike when their compartment crosses it in the linear algebra (sets --algebra)")
+    ("timeline", po::value<std::string>()->default_value("none"),
+    "record the phases of every thread, every rank writes $timeline_rank.json (chrome://tracing, ui.perfetto.dev) and a summary is printed")
+    ("cost", po::value<std::string>()->default_value("none"),
+    "the distribution of the cells on the ranks: none (contiguous blocks of cells), lognormal (synthetic heavy tailed cost per cell) or a file with the cost of every gid, balanced by longest processing time first")
+    ("replay", po::value<std::string>()->default_value("none"),
+    "no simulation, replay the allgather_v_sizes_ file (total spikes per step over the ranks) of spike_interface_stats_collector_large_mpi, measured on --numprocs ranks, through a network model")
+    ("replay-max", po::value<std::string>()->default_value("none"),
+    "the allgather_v_sizes_max file of the replay (spikes of the busiest rank per step), the mean rank if none")
+    ("model", po::value<std::string>()->default_value("alpha-beta"),
+    "the network model of the replay: alpha-beta (--alpha, --beta) or loggp (--L, --o, --g, --G)")
+    ("alpha", po::value<double>()->default_value(1.5e-6), "alpha-beta latency (s)")
+    ("beta", po::value<double>()->default_value(1e-10), "alpha-beta time per byte (s)")
+    ("L", po::value<double>()->default_value(1e-6), "LogGP latency (s)")
+    ("o", po::value<double>()->default_value(0.5e-6), "LogGP overhead of a send or a receive (s)")
+    ("g", po::value<double>()->default_value(0.6e-6), "LogGP gap between two messages (s)")
+    ("G", po::value<double>()->default_value(1e-10), "LogGP gap per byte (s)")
+    ("scaling", po::value<std::string>()->default_value("weak"),
+    "the replay at P ranks: weak (the spikes per rank are kept) or strong (the total is kept)")
+    ("degree", po::value<size_t>()->default_value(16),
+    "the neighbors of a rank in the neighbor allgather of the replay")
+    ("maxprocs", po::value<size_t>()->default_value(16384),
+    "the replay predicts the exchange on numprocs, 2*numprocs ... up to maxprocs ranks")
     ("distributed", "if set, use distributed graph implementation")
     ("algebra","If set, perform linear algebra");
 
@@ -85,11 +128,130 @@ int event_help(int argc, char* const argv[], po::variables_map& vm){
 	return mapp::MAPP_BAD_ARG;
     }
 
-    if(vm["numcells"].as<size_t>() < vm["numprocs"].as<size_t>()){
+    if(vm["replay"].as<std::string>() == "none" && vm["numcells"].as<size_t>() < vm["numprocs"].as<size_t>()){
 	std::cout<<"must have at least 1 gid per process"<<std::endl;
 	return mapp::MAPP_BAD_ARG;
     }
 
+    queueing::queue_type type;
+    if(!queueing::queue_type_from_string(vm["queue"].as<std::string>(), type)){
+	std::cout<<"queue must be heap, radix, sptq, bin or ladder"<<std::endl;
+	return mapp::MAPP_BAD_ARG;
+    }
+
+    queueing::inter_thread_type ite;
+    if(!queueing::inter_thread_type_from_string(vm["ite"].as<std::string>(), ite)){
+	std::cout<<"ite must be mutex or spsc"<<std::endl;
+	return mapp::MAPP_BAD_ARG;
+    }
+
+    std::string exchange = vm["exchange"].as<std::string>();
+    if(exchange != "blocking" && exchange != "nonblocking" && exchange != "sparse" && exchange != "hierarchical" && exchange != "multiple"){
+	std::cout<<"exchange must be blocking, nonblocking, sparse, hierarchical or multiple"<<std::endl;
+	return mapp::MAPP_BAD_ARG;
+    }
+
+    if(exchange == "nonblocking" && vm["mindelay"].as<size_t>() < 2){
+	std::cout<<"the nonblocking exchange integrates mindelay/2 per fixed step, mindelay must be >= 2"<<std::endl;
+	return mapp::MAPP_BAD_ARG;
+    }
+
+    if((exchange == "sparse" || exchange == "hierarchical" || exchange == "multiple") && vm.count("distributed")){
+	std::cout<<"the "<<exchange<<" exchange does not use the distributed graph"<<std::endl;
+	return mapp::MAPP_BAD_ARG;
+    }
+
+    std::string wire = vm["wire"].as<std::string>();
+    if(wire != "event" && wire != "compact"){
+	std::cout<<"wire must be event or compact"<<std::endl;
+	return mapp::MAPP_BAD_ARG;
+    }
+
+    queueing::schedule_type schedule;
+    if(!queueing::schedule_type_from_string(vm["schedule"].as<std::string>(), schedule)){
+	std::cout<<"schedule must be static, dynamic or balanced"<<std::endl;
+	return mapp::MAPP_BAD_ARG;
+    }
+
+    std::string generator = vm["generator"].as<std::string>();
+    if(generator != "kai" && generator != "parallel" && generator != "stream"){
+	std::cout<<"generator must be kai, parallel or stream"<<std::endl;
+	return mapp::MAPP_BAD_ARG;
+    }
+
+    std::string threshold = vm["threshold"].as<std::string>();
+    char* end = NULL;
+    strtod(threshold.c_str(), &end);
+    if(threshold != "none" && (threshold.empty() || *end != '\0')){
+	std::cout<<"threshold must be none or a voltage"<<std::endl;
+	return mapp::MAPP_BAD_ARG;
+    }
+
+    std::string model = vm["model"].as<std::string>();
+    if(model != "alpha-beta" && model != "loggp"){
+	std::cout<<"model must be alpha-beta or loggp"<<std::endl;
+	return mapp::MAPP_BAD_ARG;
+    }
+
+    std::string scaling = vm["scaling"].as<std::string>();
+    if(scaling != "weak" && scaling != "strong"){
+	std::cout<<"scaling must be weak or strong"<<std::endl;
+	return mapp::MAPP_BAD_ARG;
+    }
+
+    return mapp::MAPP_OK;
+}
+
+/** \fn event_replay(po::variables_map const& vm)
+    \brief predicts the exchange time per step of every algorithm against the
+    number of ranks, from the sizes recorded on numprocs ranks (no MPI)
+    \param vm encapsulate the command line and all needed informations
+    \return error message from mapp::mapp_error
+ */
+int event_replay(po::variables_map const& vm){
+    std::string max = vm["replay-max"].as<std::string>();
+    std::vector<spike::exchange_step> steps;
+    if(!spike::read_steps(vm["replay"].as<std::string>(), max == "none" ? "" : max, steps) || steps.empty()){
+	std::cout<<"cannot read the replay files"<<std::endl;
+	return mapp::MAPP_BAD_DATA;
+    }
+
+    spike::network_model net;
+    if(vm["model"].as<std::string>() == "loggp")
+        net.kind_ = spike::network_model::loggp;
+    net.alpha_ = vm["alpha"].as<double>();
+    net.beta_ = vm["beta"].as<double>();
+    net.L_ = vm["L"].as<double>();
+    net.o_ = vm["o"].as<double>();
+    net.g_ = vm["g"].as<double>();
+    net.G_ = vm["G"].as<double>();
+
+    spike::exchange_scaling s;
+    s.nprocs_ = vm["numprocs"].as<size_t>();
+    s.weak_ = (vm["scaling"].as<std::string>() == "weak");
+    s.fanout_ = vm["fanin"].as<size_t>();
+    s.degree_ = vm["degree"].as<size_t>();
+    s.bytes_ = (vm["wire"].as<std::string>() == "compact") ? 8 : 12;
+
+    std::cout<<steps.size()<<" steps measured on "<<s.nprocs_<<" ranks, "
+             <<vm["model"].as<std::string>()<<" model, "<<vm["scaling"].as<std::string>()
+             <<" scaling, predicted exchange time per step in us (mean / max over the steps)"<<std::endl;
+    std::cout<<std::setw(8)<<"P";
+    for(int a = 0; a < spike::nalgorithms; ++a)
+        std::cout<<std::setw(24)<<spike::algorithm_name(static_cast<spike::exchange_algorithm>(a));
+    std::cout<<std::endl;
+    for(size_t p = s.nprocs_; p <= vm["maxprocs"].as<size_t>(); p *= 2){
+        std::cout<<std::setw(8)<<p;
+        for(int a = 0; a < spike::nalgorithms; ++a){
+            std::vector<double> t = spike::replay(net, static_cast<spike::exchange_algorithm>(a), steps, p, s);
+            double mean = std::accumulate(t.begin(), t.end(), 0.)/t.size();
+            double worst = *std::max_element(t.begin(), t.end());
+            std::stringstream cell;
+            cell<<std::fixed<<std::setprecision(1)<<mean*1e6<<" / "<<worst*1e6;
+            std::cout<<std::setw(24)<<cell.str();
+        }
+        std::cout<<std::endl;
+    }
     return mapp::MAPP_OK;
 }
 
@@ -114,6 +276,16 @@ void event_content(po::variables_map const& vm){
     size_t mindelay = vm["mindelay"].as<size_t>();
     size_t algebra = vm.count("algebra");
     bool distributed = vm.count("distributed");
+    std::string queue = vm["queue"].as<std::string>();
+    std::string trace = vm["trace"].as<std::string>();
+    std::string ite = vm["ite"].as<std::string>();
+    std::string exchange = vm["exchange"].as<std::string>();
+    std::string wire = vm["wire"].as<std::string>();
+    std::string schedule = vm["schedule"].as<std::string>();
+    std::string generator = vm["generator"].as<std::string>();
+    std::string threshold = vm["threshold"].as<std::string>();
+    std::string timeline = vm["timeline"].as<std::string>();
+    std::string cost = vm["cost"].as<std::string>();
 
     std::string exec;
     if(distributed){
@@ -127,7 +299,7 @@ void event_content(po::variables_map const& vm){
         mpi_run <<" -n "<< nproc << " " << path << exec <<
         ngroup << " " << simtime << " " <<
         ncells << " " << fanin << " " <<
-        nspike << " " << mindelay << " " << algebra;
+        nspike << " " << mindelay << " " << algebra << " " << queue << " " << trace << " " << ite << " " << exchange << " " << wire << " " << schedule << " " << generator << " " << threshold << " " << timeline << " " << cost;
 
     std::cout<< "Running command " << command.str() <<std::endl;
 	system(command.str().c_str());
@@ -137,6 +309,8 @@ int event_execute(int argc, char* const argv[]){
     try {
         po::variables_map vm; // it contains everything
         if(int error = event_help(argc, argv, vm)) return error;
+        if(vm["replay"].as<std::string>() != "none")
+            return event_replay(vm); // the network model only
         event_content(vm); // execute the miniapp
     }
     catch(std::exception& e){
@@ -0,0 +1,116 @@
+/*
+ * Neuromapp - counter_rng.h, Copyright (c), 2015,
+ * Kai Langen - Swiss Federal Institute of technology in Lausanne,
+ * kai.langen@epfl.ch,
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.
+ */
+
+/**
+ * @file neuromapp/coreneuron_1.0/environment/counter_rng.h
+ * \brief Contains the counter based random number generator of the event
+ * generators.
+ */
+
+#ifndef MAPP_COUNTER_RNG_H
+#define MAPP_COUNTER_RNG_H
+
+#include <cmath>
+#include <boost/cstdint.hpp>
+
+namespace environment {
+
+/** \fn philox4x32(const boost::uint32_t ctr[4], const boost::uint32_t key[2], boost::uint32_t out[4])
+ *  \brief Philox4x32-10 (Salmon et al., SC11): out is a bijection of the
+ *  counter ctr for the key, 10 rounds of multiplications and xors. No state,
+ *  the n-th number of a stream is computed directly from n.
+ */
+inline void philox4x32(const boost::uint32_t ctr[4], const boost::uint32_t key[2],
+                       boost::uint32_t out[4]){
+    boost::uint32_t c0 = ctr[0], c1 = ctr[1], c2 = ctr[2], c3 = ctr[3];
+    boost::uint32_t k0 = key[0], k1 = key[1];
+    for(int r = 0; r < 10; ++r){
+        const boost::uint64_t p0 = static_cast<boost::uint64_t>(0xD2511F53u)*c0;
+        const boost::uint64_t p1 = static_cast<boost::uint64_t>(0xCD9E8D57u)*c2;
+        c0 = static_cast<boost::uint32_t>(p1 >> 32) ^ c1 ^ k0;
+        c2 = static_cast<boost::uint32_t>(p0 >> 32) ^ c3 ^ k1;
+        c1 = static_cast<boost::uint32_t>(p1);
+        c3 = static_cast<boost::uint32_t>(p0);
+        k0 += 0x9E3779B9u;
+        k1 += 0xBB67AE85u;
+    }
+    out[0] = c0; out[1] = c1; out[2] = c2; out[3] = c3;
+}
+
+/** counter_rng
+ *  \brief the random numbers of the stream (seed, stream) for the substream
+ *  (e.g. a time window): two generators with the same triplet give the same
+ *  numbers, whatever the thread or the order in which they are created.
+ */
+class counter_rng {
+private:
+    boost::uint32_t key_[2];
+    boost::uint32_t ctr_[4];
+    boost::uint32_t block_[4];
+    int next_; // next number of block_
+
+public:
+    counter_rng(boost::uint32_t seed, boost::uint32_t stream, boost::uint32_t substream = 0):next_(4){
+        key_[0] = seed;
+        key_[1] = stream;
+        ctr_[0] = 0;
+        ctr_[1] = 0;
+        ctr_[2] = substream;
+        ctr_[3] = 0;
+    }
+
+    /** \fn operator()()
+     *  \return the next 32 bits random number
+     */
+    inline boost::uint32_t operator()(){
+        if(next_ == 4){
+            philox4x32(ctr_, key_, block_);
+            if(++ctr_[0] == 0)
+                ++ctr_[1];
+            next_ = 0;
+        }
+        return block_[next_++];
+    }
+
+    /** \fn uniform()
+     *  \return a uniform number in (0,1)
+     */
+    inline double uniform(){
+        return ((*this)() + 0.5)*(1./4294967296.);
+    }
+
+    /** \fn exponential(double rate)
+     *  \return an exponential number of parameter rate
+     */
+    inline double exponential(double rate){
+        return -std::log(uniform())/rate;
+    }
+
+    /** \fn uniform_int(int n)
+     *  \return a uniform integer in [0,n)
+     */
+    inline int uniform_int(int n){
+        return static_cast<int>((static_cast<boost::uint64_t>((*this)())*n) >> 32);
+    }
+};
+
+}// end of namespace
+
+#endif
@@ -36,6 +36,8 @@
 #include <cassert>
 
 #include "coreneuron_1.0/event_passing/environment/generator.h"
+#include "coreneuron_1.0/event_passing/environment/stream_generator.h"
+#include "utils/omp/compatibility.h"
 
 namespace environment {
 
@@ -70,6 +72,23 @@ namespace environment {
     template< typename Iterator >
     void generate_poisson_events(Iterator beg, int simtime, int ngroups, int rank, int nprocs, double lambda, neurondistribution* neuron_dist);
 
+    /** \fn void generate_events_parallel(Iterator beg, int simtime, int ngroups, int rank, int nprocs, double lambda, neurondistribution* neuron_dist, int window, unsigned int seed)
+        \brief generates the events of generate_events_kai, the cell groups in parallel (OpenMP).
+	\param beg iterator to the beginning of the vector of queues of events.
+	\param simtime total time of simulation (in number of timesteps)
+	\param ngroups number of cellgroups per distributed rank
+	\param rank distributed rank number
+	\param nprocs the total number of distributed ranks in the whole simulation
+	\param lambda the firing frequency of a single cell (in num events/timestep )
+	\param neuron_dist the local cells
+	\param window the time steps of a random stream
+	\param seed the seed of the simulation
+
+	Every cell group has its own counter based random streams (one per window, see stream_generator), a thread fills the queue of a group without any shared state. The events are identical for any number of threads, and identical to the events of a stream_generator with the same window and seed.
+*/
+    template< typename Iterator >
+    void generate_events_parallel(Iterator beg, int simtime, int ngroups, int rank, int nprocs, double lambda, neurondistribution* neuron_dist, int window = 1, unsigned int seed = 0);
+
     template< typename Iterator >
     void generate_poisson_events_net(Iterator beg, const int& seed,  const int& simtime, const double& net_firing_rate, const neurondistribution& neuron_dist);
 
@@ -96,6 +96,21 @@ void generate_poisson_events(Iterator beg, int simtime, int ngroups, int rank, i
 }
 
 
+template< typename Iterator >
+void generate_events_parallel(Iterator beg, int simtime, int ngroups, int rank, int nprocs, double lambda, neurondistribution* neuron_dist, int window, unsigned int seed) {
+
+    //the groups are independent, they are consumed concurrently
+    stream_generator streamer(ngroups, simtime, rank, nprocs, lambda, neuron_dist, window, seed);
+
+    #pragma omp parallel for schedule(dynamic,1)
+    for(int i = 0; i < ngroups; ++i){
+        Iterator it = beg;
+        std::advance(it, i);
+        while(streamer.compare_top_lte(i, simtime))
+            it->push(streamer.pop(i));
+    }
+}
+
 template< typename Iterator >
 void generate_poisson_events_net(Iterator beg, const int& seed,  const int& simtime, const double& net_firing_rate, const neurondistribution& neuron_dist) { 
     gen_event new_event;
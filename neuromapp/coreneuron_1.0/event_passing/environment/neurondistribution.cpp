@@ -5,8 +5,14 @@
  *      Author: schumann
  */
 #include <cassert>
+#include <cmath>
 #include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <functional>
+#include <queue>
 #include "coreneuron_1.0/event_passing/environment/neurondistribution.h"
+#include "coreneuron_1.0/event_passing/environment/counter_rng.h"
 
 environment::continousdistribution::continousdistribution(size_t groups, size_t me, size_t cells):
         global_number(cells)
@@ -34,6 +40,151 @@ environment::continousdistribution::continousdistribution(size_t groups, size_t
         start += offset;
 }
 
+namespace {
+    /** order of the cells in the LPT, decreasing cost then increasing gid */
+    struct costlier {
+        explicit costlier(const std::vector<double>& cost):cost_(cost){}
+        inline bool operator()(size_t a, size_t b) const {
+            return cost_[a] > cost_[b] || (cost_[a] == cost_[b] && a < b);
+        }
+        const std::vector<double>& cost_;
+    };
 
+    double max_over_mean(const std::vector<double>& loads)
+    {
+        double sum = 0., max = 0.;
+        for (size_t i = 0; i < loads.size(); ++i) {
+            sum += loads[i];
+            max = std::max(max, loads[i]);
+        }
+        return sum > 0. ? max*loads.size()/sum : 1.;
+    }
+}
+
+environment::weighteddistribution::weighteddistribution(size_t groups, size_t me, const std::vector<double>& cost):
+    global_number(cost.size())
+{
+    std::vector<size_t> gids(cost.size());
+    for (size_t i = 0; i < gids.size(); ++i)
+        gids[i] = i;
+    assign(groups, me, gids, cost);
+}
+
+environment::weighteddistribution::weighteddistribution(size_t groups, size_t me, const environment::neurondistribution* parent_distr,
+                                                        const std::vector<double>& cost):
+    global_number(parent_distr->getglobalcells())
+{
+    assert(cost.size() == global_number);
+    std::vector<size_t> gids(parent_distr->getlocalcells());
+    for (size_t i = 0; i < gids.size(); ++i)
+        gids[i] = parent_distr->local2global(i);
+    assign(groups, me, gids, cost);
+}
+
+void environment::weighteddistribution::assign(size_t groups, size_t me, const std::vector<size_t>& gids,
+                                               const std::vector<double>& cost)
+{
+    std::vector<size_t> order(gids);
+    std::sort(order.begin(), order.end(), costlier(cost));
+
+    //smallest load on top, the smallest group on a tie
+    typedef std::pair<double, size_t> load;
+    std::priority_queue<load, std::vector<load>, std::greater<load> > heap;
+    for (size_t g = 0; g < groups; ++g)
+        heap.push(load(0., g));
+
+    loads.assign(groups, 0.);
+    for (size_t i = 0; i < order.size(); ++i) {
+        load l = heap.top();
+        heap.pop();
+        l.first += cost[order[i]];
+        loads[l.second] = l.first;
+        heap.push(l);
+        if (l.second == me) {
+            cells.push_back(order[i]);
+        }
+    }
+    std::sort(cells.begin(), cells.end());
+}
+
+bool environment::weighteddistribution::isLocal(size_t id) const
+{
+    assert(id < global_number);
+
+    return std::binary_search(cells.begin(), cells.end(), id);
+}
+
+size_t environment::weighteddistribution::global2local(size_t glo) const
+{
+    std::vector<size_t>::const_iterator it = std::lower_bound(cells.begin(), cells.end(), glo);
+    assert(it != cells.end() && *it == glo);
 
+    return it - cells.begin();
+}
+
+double environment::weighteddistribution::imbalance() const
+{
+    return max_over_mean(loads);
+}
+
+double environment::contiguous_imbalance(size_t groups, const std::vector<double>& cost)
+{
+    std::vector<double> loads(groups, 0.);
+    for (size_t g = 0; g < groups; ++g) {
+        environment::continousdistribution d(groups, g, cost.size());
+        for (size_t i = 0; i < d.getlocalcells(); ++i)
+            loads[g] += cost[d.local2global(i)];
+    }
+    return max_over_mean(loads);
+}
 
+bool environment::cell_costs(const std::string& source, size_t cells, std::vector<double>& cost)
+{
+    cost.resize(cells);
+    if (source == "lognormal") {
+        //Box-Muller, the gid is the stream
+        for (size_t i = 0; i < cells; ++i) {
+            environment::counter_rng rng(4321, i);
+            const double u = rng.uniform();
+            const double v = rng.uniform();
+            cost[i] = std::exp(std::sqrt(-2.*std::log(u))*std::cos(2.*M_PI*v));
+        }
+        return true;
+    }
+
+    std::ifstream in(source.c_str());
+    size_t n = 0;
+    for (; n < cells && in >> cost[n]; ++n) {}
+    return n == cells;
+}
+
+environment::neurondistribution* environment::make_distribution(const std::string& cost, size_t groups, size_t me,
+                                                                size_t cells, std::vector<double>& costs)
+{
+    costs.clear();
+    if (cost == "none")
+        return new environment::continousdistribution(groups, me, cells);
+    if (!cell_costs(cost, cells, costs)) {
+        costs.clear();
+        return NULL;
+    }
+    return new environment::weighteddistribution(groups, me, costs);
+}
+
+environment::neurondistribution* environment::make_distribution(size_t groups, size_t me,
+                                                                environment::neurondistribution* parent_distr,
+                                                                const std::vector<double>& costs)
+{
+    if (costs.empty())
+        return new environment::continousdistribution(groups, me,
+                       static_cast<environment::continousdistribution*>(parent_distr));
+    return new environment::weighteddistribution(groups, me, parent_distr, costs);
+}
+
+double environment::local_cost(const environment::neurondistribution& d, const std::vector<double>& cost)
+{
+    double sum = 0.;
+    for (size_t i = 0; i < d.getlocalcells(); ++i)
+        sum += cost[d.local2global(i)];
+    return sum;
+}
@@ -8,6 +8,10 @@
 #ifndef NEURONDISTRIBUTION_H_
 #define NEURONDISTRIBUTION_H_
 
+#include <cassert>
+#include <string>
+#include <vector>
+
 typedef long unsigned int size_t;
 
 namespace environment
@@ -86,6 +90,94 @@ namespace environment
         size_t local_number;
         size_t start;
     };
+
+    class weighteddistribution : public neurondistribution {
+    public:
+        /**
+         *  Create a distribution balanced by the cost of the cells (cost[gid]):
+         *  longest processing time first, the most expensive cells first, each
+         *  on the group with the smallest load (the smallest group on a tie).
+         *  Every group must give the same costs.
+         */
+        weighteddistribution(size_t groups, size_t me, const std::vector<double>& cost);
+        /**
+         *  Create a balanced distribution of the local cells of the given
+         *  parent distribution, cost is indexed by the gid
+         */
+        weighteddistribution(size_t groups, size_t me, const neurondistribution* parent_distr,
+                             const std::vector<double>& cost);
+
+        ~weighteddistribution() {};
+
+        inline size_t getlocalcells() const
+        {
+            return cells.size();
+        }
+        inline size_t getglobalcells() const
+        {
+            return global_number;
+        }
+        /**
+         *  O(log(local cells)), no index over the global cells
+         */
+        bool isLocal(size_t id) const;
+        /**
+         *  O(log(local cells)), the local gids are sorted
+         */
+        size_t global2local(size_t glo) const;
+        inline size_t local2global(size_t loc) const
+        {
+            assert(loc < cells.size());
+
+            return cells[loc];
+        }
+        /**
+         *  Largest load of a group over the mean load
+         */
+        double imbalance() const;
+
+    private:
+        void assign(size_t groups, size_t me, const std::vector<size_t>& gids,
+                    const std::vector<double>& cost);
+
+        const size_t global_number;
+        std::vector<size_t> cells; // the local gids, sorted
+        std::vector<double> loads; // the load of every group
+    };
+
+    /**
+     *  Largest load of a group over the mean load of the contiguous
+     *  distribution of cost.size() cells on groups
+     */
+    double contiguous_imbalance(size_t groups, const std::vector<double>& cost);
+
+    /**
+     *  The cost of every cell: lognormal (synthetic heavy tail, sigma 1, the
+     *  same on every rank) or the name of a file with one cost per gid.
+     *  Return false if the file cannot be read or has not cells costs.
+     */
+    bool cell_costs(const std::string& source, size_t cells, std::vector<double>& cost);
+
+    /**
+     *  The distribution of the drivers: contiguous if cost is none (costs is
+     *  empty), else balanced by the costs of cell_costs(cost), NULL if they
+     *  cannot be read. The caller deletes the distribution.
+     */
+    neurondistribution* make_distribution(const std::string& cost, size_t groups, size_t me,
+                                          size_t cells, std::vector<double>& costs);
+
+    /**
+     *  The distribution of the local cells of parent_distr on groups (the
+     *  threads), contiguous if costs is empty (parent_distr must be a
+     *  continousdistribution), else balanced by costs
+     */
+    neurondistribution* make_distribution(size_t groups, size_t me, neurondistribution* parent_distr,
+                                          const std::vector<double>& costs);
+
+    /**
+     *  Sum of the costs of the local cells of d
+     */
+    double local_cost(const neurondistribution& d, const std::vector<double>& cost);
 };
 
 #endif /* NEURONDISTRIBUTION_H_ */
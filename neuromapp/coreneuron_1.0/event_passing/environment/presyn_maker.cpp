@@ -7,17 +7,21 @@
 #include <boost/range/algorithm_ext/iota.hpp>
 #include <boost/random/mersenne_twister.hpp>
 #include <boost/random.hpp>
+#include <algorithm>
+#include <limits>
 
 #include "coreneuron_1.0/event_passing/environment/presyn_maker.h"
 
 namespace environment {
 
 void presyn_maker::operator()(int rank, neurondistribution* neuron_dist){
-    //create local presyns with empty vectors
+    //create local presyns with empty rows
+    std::vector<int> local(neuron_dist->getlocalcells());
     for(int i = 0; i < neuron_dist->getlocalcells(); ++i){
-        const int gid = neuron_dist->local2global(i);
-        outputs_[gid];
+        local[i] = neuron_dist->local2global(i);
     }
+    edges outputs;
+    edges inputs;
 
     if (degree_==fixedindegree) {
         //used for random presyn and netcon selection
@@ -32,13 +36,13 @@ void presyn_maker::operator()(int rank, neurondistribution* neuron_dist){
                 if(neuron_dist->isLocal(cur)){
                     //add self to src gid
                     const int g_i = neuron_dist->local2global(i);
-                    outputs_[cur].push_back(g_i);
+                    outputs.push_back(std::make_pair(cur, g_i));
                 }
                 //remote GID
                 else{
                     //add self to input presyn for gid
                     const int g_i = neuron_dist->local2global(i);
-                    inputs_[cur].push_back(g_i);
+                    inputs.push_back(std::make_pair(cur, g_i));
                 }
             }
         }
@@ -57,37 +61,129 @@ void presyn_maker::operator()(int rank, neurondistribution* neuron_dist){
                 if(neuron_dist->isLocal(picked)) {
                     if(neuron_dist->isLocal(cur)){
                         //add self to src gid
-                        outputs_[cur].push_back(picked);
+                        outputs.push_back(std::make_pair(cur, picked));
                     }
                     //remote GID
                     else{
                         //add self to input presyn for gid
-                        inputs_[cur].push_back(picked);
+                        inputs.push_back(std::make_pair(cur, picked));
                     }
                 }
             }
         }
     }
+
+    outputs_.build(outputs, local);
+    inputs_.build(inputs, std::vector<int>());
+    index();
+}
+
+/** order of the edges by gid only, stable_sort keeps the order of the targets */
+struct edge_gid_less {
+    inline bool operator()(const std::pair<int, int>& a, const std::pair<int, int>& b) const {
+        return a.first < b.first;
+    }
+};
+
+void presyn_maker::csr::build(edges& e, const std::vector<int>& gids){
+    std::stable_sort(e.begin(), e.end(), edge_gid_less());
+    gids_.clear();
+    gids_.reserve(gids.size());
+    for(size_t i = 0; i < e.size(); ++i){
+        if(gids_.empty() || gids_.back() != e[i].first)
+            gids_.push_back(e[i].first);
+    }
+    gids_.insert(gids_.end(), gids.begin(), gids.end());
+    std::sort(gids_.begin(), gids_.end());
+    gids_.erase(std::unique(gids_.begin(), gids_.end()), gids_.end());
+    std::vector<int>(gids_).swap(gids_);
+
+    targets_.resize(e.size());
+    for(size_t i = 0; i < e.size(); ++i){
+        targets_[i] = e[i].second;
+    }
+
+    //the rows point into targets_, it is not resized anymore
+    rows_.resize(gids_.size());
+    const int* base = targets_.empty() ? NULL : &targets_[0];
+    size_t k = 0;
+    for(size_t i = 0; i < gids_.size(); ++i){
+        const size_t first = k;
+        while(k < e.size() && e[k].first == gids_[i])
+            ++k;
+        rows_[i] = presyn(base + first, k - first);
+    }
+    edges().swap(e);
+}
+
+std::size_t presyn_maker::csr::memory() const{
+    return gids_.capacity()*sizeof(int) + rows_.capacity()*sizeof(presyn)
+        + targets_.capacity()*sizeof(int);
+}
+
+void presyn_maker::index(){
+    //dense over [first, last] local gid if the local gids are about
+    //contiguous, else find_output searches the sorted gids (the range of a
+    //weighted distribution is close to all the global gids)
+    output_index_.clear();
+    output_first_ = 0;
+    const size_t n_out = outputs_.gids_.size();
+    if(n_out > 0 && static_cast<size_t>(outputs_.gids_.back() - outputs_.gids_.front()) < 2*n_out){
+        output_first_ = outputs_.gids_.front();
+        output_index_.resize(outputs_.gids_.back() - output_first_ + 1, -1);
+        for(size_t i = 0; i < outputs_.gids_.size(); ++i)
+            output_index_[outputs_.gids_[i] - output_first_] = i;
+    }
+
+    //load factor <= 1/2, linear probing
+    size_t n = 2;
+    input_shift_ = 31;
+    while(n < 2*inputs_.gids_.size()){
+        n <<= 1;
+        --input_shift_;
+    }
+    input_table_.assign(n, -1);
+    for(size_t i = 0; i < inputs_.gids_.size(); ++i){
+        size_t slot = input_slot(inputs_.gids_[i]);
+        while(input_table_[slot] != -1)
+            slot = (slot + 1) & (n - 1);
+        input_table_[slot] = i;
+    }
 }
 
 const presyn* presyn_maker::find_input(int key) const{
-    std::map<int, std::vector<int> >::const_iterator it = inputs_.begin();
-    const presyn* input_ptr = NULL;
-    it = inputs_.find(key);
-    if(it != inputs_.end()){
-        input_ptr = &(it->second);
+    if(inputs_.gids_.empty())
+        return NULL;
+    const size_t mask = input_table_.size() - 1;
+    for(size_t slot = input_slot(key); input_table_[slot] != -1; slot = (slot + 1) & mask){
+        const int row = input_table_[slot];
+        if(inputs_.gids_[row] == key)
+            return &inputs_.rows_[row];
     }
-    return input_ptr;
+    return NULL;
 }
 
 const presyn* presyn_maker::find_output(int key) const{
-    std::map<int, std::vector<int> >::const_iterator it = outputs_.begin();
-    const presyn* output_ptr = NULL;
-    it = outputs_.find(key);
-    if(it != outputs_.end()){
-        output_ptr = &(it->second);
+    if(output_index_.empty()){
+        std::vector<int>::const_iterator it =
+            std::lower_bound(outputs_.gids_.begin(), outputs_.gids_.end(), key);
+        if(it == outputs_.gids_.end() || *it != key)
+            return NULL;
+        return &outputs_.rows_[it - outputs_.gids_.begin()];
     }
-    return output_ptr;
+    const long i = static_cast<long>(key) - output_first_;
+    if(i < 0 || i >= static_cast<long>(output_index_.size()) || output_index_[i] == -1)
+        return NULL;
+    return &outputs_.rows_[output_index_[i]];
+}
+
+void presyn_maker::input_gids(std::vector<int>& gids) const{
+    gids = inputs_.gids_;
+}
+
+std::size_t presyn_maker::memory() const{
+    return inputs_.memory() + outputs_.memory()
+        + output_index_.capacity()*sizeof(int) + input_table_.capacity()*sizeof(int);
 }
 
 } //end of namespace
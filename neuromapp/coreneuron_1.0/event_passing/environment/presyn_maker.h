@@ -26,24 +26,87 @@
 #ifndef MAPP_PRESYN_MAKER_H
 #define MAPP_PRESYN_MAKER_H
 
-#include <map>
+#include <cstddef>
+#include <utility>
+#include <vector>
 
 #include "coreneuron_1.0/event_passing/environment/generator.h"
 #include "coreneuron_1.0/event_passing/environment/neurondistribution.h"
 
 namespace environment {
 
-typedef std::vector<int> presyn;
+/** presyn
+ * the destinations of a gid: a row of the CSR connectivity of the
+ * presyn_maker, it points into the targets array of the presyn_maker
+ */
+class presyn {
+public:
+    presyn(): first_(NULL), size_(0) {}
+    presyn(const int* first, std::size_t size): first_(first), size_(size) {}
+
+    inline std::size_t size() const { return size_; }
+    inline bool empty() const { return size_ == 0; }
+    inline int operator[](std::size_t i) const { return first_[i]; }
+    inline const int* begin() const { return first_; }
+    inline const int* end() const { return first_ + size_; }
+private:
+    const int* first_;
+    std::size_t size_;
+};
+
 enum degree {fixedindegree, fixedoutdegree};
 /** presyn_maker
  * creates input and output presyns required for spike exchange
+ *
+ * The connectivity is stored in CSR: the targets of all the presyns are
+ * contiguous in one array, a row (presyn) per gid. The output presyns (local
+ * gids) are found with a dense index over the range of the local gids if
+ * they are about contiguous, by binary search of the sorted gids otherwise,
+ * the input presyns (remote gids) with an open addressing hash table of the
+ * rows. No node based container.
  */
 class presyn_maker {
 private:
+    typedef std::vector<std::pair<int, int> > edges; // (gid, target)
+
+    /// one row of targets per gid
+    struct csr {
+        std::vector<int> gids_; // gid of every row, increasing order
+        std::vector<presyn> rows_;
+        std::vector<int> targets_;
+        /** \fn build(edges& e, const std::vector<int>& gids)
+         *  \brief a row for every gid of gids and every source of e, the targets
+         *  of a row keep the order of e
+         */
+        void build(edges& e, const std::vector<int>& gids);
+        std::size_t memory() const;
+    };
+
     int fan_;
     degree degree_;
-    std::map<int, presyn> inputs_;
-    std::map<int, presyn> outputs_;
+    csr inputs_;
+    csr outputs_;
+    /// output row of the gid output_first_ + i, -1 if none, empty if the
+    /// local gids are sparse
+    int output_first_;
+    std::vector<int> output_index_;
+    /// input row by hash of the gid, -1 if empty slot, power of 2 size
+    std::vector<int> input_table_;
+    int input_shift_; // 32 - log2(input_table_.size())
+
+    presyn_maker(const presyn_maker&);
+    presyn_maker& operator=(const presyn_maker&);
+
+    inline std::size_t input_slot(int gid) const {
+        //Fibonacci hashing, the high bits of the product
+        return (static_cast<unsigned int>(gid)*2654435761u) >> input_shift_;
+    }
+
+    /** \fn index()
+     *  \brief builds the dense output index (contiguous local gids) and the
+     *  input hash table
+     */
+    void index();
 public:
     /** \fn presyn_maker(int ncells, int fanin)
      *  \brief creates the presyn_maker and sets member variables
@@ -51,7 +114,7 @@ public:
      *  \param fan the number of in/outcoming connections per cell
      */
     explicit presyn_maker(int fan=0, degree fd=fixedindegree):
-    fan_(fan), degree_(fd){}
+    fan_(fan), degree_(fd), output_first_(0), input_shift_(31){}
 
     /** \fn void operator()(int nprocs, int ngroups, int rank)
      *  \brief generates both the input and output presyns.
@@ -63,25 +126,33 @@ public:
 
 //GETTERS
 
-    /** \fn find_input(int id, presyn& ps)
-     *  \brief searches for an input presyn(IP) matching the parameter key. If
-     *  IP is found, the param presyn is modified to reference the desired IP.
+    /** \fn find_input(int key)
+     *  \brief searches for an input presyn(IP) matching the parameter key,
+     *  O(1) in the hash table of the remote gids.
      *  \param key integer key used to find the input presyn
-     *  \param ps used to return the matching input presyn val by reference
-     *  only valid if find_input returns true.
-     *  \return true if matching presyn is found, else false
+     *  \return the matching presyn, NULL if not found
      */
     const presyn* find_input(int key) const;
 
-    /** \fn find_output(int key, presyn& ps)
-     *  \brief searches for an out presyn(OP) matching the parameter key. If
-     *  OP is found, the param presyn is modified to reference the desired OP.
+    /** \fn find_output(int key)
+     *  \brief searches for an out presyn(OP) matching the parameter key,
+     *  O(1) in the dense index of the local gids, O(log) if they are sparse.
      *  \param key the integer used to retrieve the output presyn
-     *  \param ps used to return the matching presyn val by reference
-     *  only valid if find_output returns true.
-     *  \return true if matching presyn is found, else false
+     *  \return the matching presyn, NULL if not found
      */
     const presyn* find_output(int key) const;
+
+    /** \fn input_gids(std::vector<int>& gids)
+     *  \brief the remote gids with an input presyn on this rank, increasing
+     *  order. Used by the sparse exchange to subscribe to their owners.
+     *  \param gids cleared, then filled with the gids
+     */
+    void input_gids(std::vector<int>& gids) const;
+
+    /** \fn memory()
+     *  \return the bytes used by the connectivity (CSR and indices)
+     */
+    std::size_t memory() const;
 };
 
 } //end of namespace
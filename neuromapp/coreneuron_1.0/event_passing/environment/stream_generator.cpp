@@ -0,0 +1,90 @@
+/*
+ * Neuromapp - stream_generator.cpp, Copyright (c), 2015,
+ * Kai Langen - Swiss Federal Institute of technology in Lausanne,
+ * kai.langen@epfl.ch,
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.
+ */
+
+/**
+ * @file neuromapp/coreneuron_1.0/environment/stream_generator.cpp
+ * \brief Contains stream_generator class definition.
+ */
+
+#include <algorithm>
+
+#include "coreneuron_1.0/event_passing/environment/stream_generator.h"
+#include "coreneuron_1.0/event_passing/environment/counter_rng.h"
+
+namespace environment {
+
+stream_generator::stream_generator(int ngroups, int simtime, int rank, int nprocs, double lambda,
+neurondistribution* neuron_dist, int window, unsigned int seed):
+streams_(ngroups), cells_(ngroups), rate_(ngroups, 0.), simtime_(simtime),
+window_(std::max(window, 1)), rank_(rank), seed_(seed){
+    //cellgroups are determined by:
+    //group # = gid % number of groups
+    for(std::size_t lid = 0; lid < neuron_dist->getlocalcells(); ++lid){
+        const int gid = neuron_dist->local2global(lid);
+        cells_[gid % ngroups].push_back(gid);
+    }
+    //the rate of the rank (see generate_events_kai) split by the cells of the groups
+    const double rank_rate = neuron_dist->getglobalcells()*lambda/nprocs;
+    for(int i = 0; i < ngroups; ++i){
+        if(neuron_dist->getlocalcells() > 0)
+            rate_[i] = rank_rate*cells_[i].size()/neuron_dist->getlocalcells();
+    }
+}
+
+void stream_generator::generate(int id){
+    group_stream& s = streams_[id];
+    s.events_.clear();
+    s.next_ = 0;
+    const int w = s.window_++;
+    if(cells_[id].empty() || !(rate_[id] > 0.))
+        return;
+
+    counter_rng rng(seed_, rank_*streams_.size() + id, w);
+    //the intervals are exponential, a window starts without memory of the previous one
+    double event_time = static_cast<double>(w)*window_;
+    const double end = std::min(static_cast<double>(w + 1)*window_, static_cast<double>(simtime_));
+    const int n = cells_[id].size();
+    while(true){
+        event_time += rng.exponential(rate_[id]);
+        if(event_time >= end)
+            break;
+        const int gid = cells_[id][rng.uniform_int(n)];
+        s.events_.push_back(gen_event(gid, static_cast<int>(event_time)));
+    }
+}
+
+bool stream_generator::compare_top_lte(int id, double comparator){
+    group_stream& s = streams_[id];
+    while(s.next_ == s.events_.size()){
+        //the next window starts after the comparator or the simulation
+        const double start = static_cast<double>(s.window_)*window_;
+        if(start > comparator || start >= simtime_)
+            return false;
+        generate(id);
+    }
+    return s.events_[s.next_].second <= comparator;
+}
+
+gen_event stream_generator::pop(int id){
+    group_stream& s = streams_[id];
+    return s.events_[s.next_++];
+}
+
+} //end of namespace
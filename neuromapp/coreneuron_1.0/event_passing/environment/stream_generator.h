@@ -0,0 +1,112 @@
+/*
+ * Neuromapp - stream_generator.h, Copyright (c), 2015,
+ * Kai Langen - Swiss Federal Institute of technology in Lausanne,
+ * kai.langen@epfl.ch,
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.
+ */
+
+/**
+ * @file neuromapp/coreneuron_1.0/environment/stream_generator.h
+ * \brief Contains stream_generator class declaration.
+ */
+
+#ifndef MAPP_STREAM_GENERATOR_H
+#define MAPP_STREAM_GENERATOR_H
+
+#include <cstddef>
+#include <vector>
+
+#include "coreneuron_1.0/event_passing/environment/generator.h"
+#include "coreneuron_1.0/event_passing/environment/neurondistribution.h"
+
+namespace environment {
+
+/** stream_generator
+ *  \brief generates the events of a cell group on demand, one time window
+ *  at a time, with the same law than generate_events_kai (exponential
+ *  intervals, uniform source in the group). Only the events of the current
+ *  window of every group are in memory.
+ *
+ *  The events of the window w of the group g come from the counter_rng
+ *  (seed, rank*ngroups + g, w): the sequence does not depend on the number
+ *  of threads or on the order in which the groups are integrated. The API
+ *  is the one of event_generator used by pool::send_events, the groups can
+ *  be consumed concurrently.
+ */
+class stream_generator {
+private:
+    /// events of the current window of a group, padded to avoid false sharing
+    struct group_stream {
+        group_stream():next_(0),window_(0){}
+        std::vector<gen_event> events_;
+        std::size_t next_; // first event not popped
+        int window_; // next window to generate
+        char pad_[64];
+    };
+    std::vector<group_stream> streams_;
+    /// gids of every group
+    std::vector<std::vector<int> > cells_;
+    /// events per time step of every group
+    std::vector<double> rate_;
+    int simtime_;
+    int window_;
+    int rank_;
+    unsigned int seed_;
+
+    /** \fn generate(int id)
+     *  \brief replaces the events of the group id by the events of its next window
+     */
+    void generate(int id);
+
+public:
+    /** \fn stream_generator(int ngroups, int simtime, int rank, int nprocs,
+     *      double lambda, neurondistribution* neuron_dist, int window, unsigned int seed)
+     *  \brief the generator constructor, no event is created
+     *  \param ngroups the number of cell groups
+     *  \param simtime the total time of the simulation
+     *  \param rank the rank of the current process
+     *  \param nprocs the number of processes in the simulation
+     *  \param lambda the firing frequency of a cell (as generate_events_kai)
+     *  \param neuron_dist the local cells
+     *  \param window the time steps generated at once (e.g. the min delay)
+     *  \param seed the seed of the simulation
+     */
+    stream_generator(int ngroups, int simtime, int rank, int nprocs, double lambda,
+                     neurondistribution* neuron_dist, int window, unsigned int seed = 0);
+
+    /** \fn gen_event pop()(int id)
+     *  \brief retrieves the next event of the group
+     *  \param id specifies which group to pop from
+     *  \precond compare_top_lte(id, t) is true
+     */
+    gen_event pop(int id);
+
+    /** \fn compare_top_lte(int id, double comparator)
+     *  \brief generates the windows of the group up to the comparator if
+     *  needed, and compares its next event against it
+     *  \return true if next event <= comparator. Else false
+     */
+    bool compare_top_lte(int id, double comparator);
+
+    /** \fn get_size(int id)
+     *  \return the number of events of the current window of the group not popped
+     */
+    int get_size(int id) const { return streams_[id].events_.size() - streams_[id].next_; }
+};
+
+}// end of namespace
+
+#endif
@@ -0,0 +1,52 @@
+/*
+ * Neuromapp - options.cpp, Copyright (c), 2015,
+ * Kai Langen - Swiss Federal Institute of technology in Lausanne,
+ * kai.langen@epfl.ch,
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.
+ */
+
+/**
+ * @file neuromapp/coreneuron_1.0/event_passing/queueing/options.cpp
+ * \brief Contains the run time options of the pool
+ */
+
+#include "coreneuron_1.0/event_passing/queueing/options.h"
+
+namespace queueing {
+
+bool inter_thread_type_from_string(const std::string& name, inter_thread_type& type){
+    if(name == "mutex")
+        type = mutex_ite;
+    else if(name == "spsc")
+        type = spsc_ite;
+    else
+        return false;
+    return true;
+}
+
+bool schedule_type_from_string(const std::string& name, schedule_type& type){
+    if(name == "static")
+        type = static_schedule;
+    else if(name == "dynamic")
+        type = dynamic_schedule;
+    else if(name == "balanced")
+        type = balanced_schedule;
+    else
+        return false;
+    return true;
+}
+
+} //end of namespace
@@ -0,0 +1,58 @@
+/*
+ * Neuromapp - options.h, Copyright (c), 2015,
+ * Kai Langen - Swiss Federal Institute of technology in Lausanne,
+ * kai.langen@epfl.ch,
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.
+ */
+
+/**
+ * @file neuromapp/coreneuron_1.0/event_passing/queueing/options.h
+ * \brief Contains the run time options of the pool
+ */
+
+#ifndef MAPP_OPTIONS_H_
+#define MAPP_OPTIONS_H_
+
+#include <string>
+
+namespace queueing {
+
+/** the inter thread path of the events between the cell groups of a rank:
+    a locked vector per receiver, or a lock free ring per (sender, receiver) */
+enum inter_thread_type {mutex_ite, spsc_ite};
+
+/** \fn bool inter_thread_type_from_string(const std::string& name, inter_thread_type& type)
+ *  \brief name of the command line (mutex, spsc) to inter_thread_type
+ *  \return false if the name is unknown
+ */
+bool inter_thread_type_from_string(const std::string& name, inter_thread_type& type);
+
+/** scheduling of the cell groups on the threads in pool::fixed_step:
+ *  static (group i on thread i % nthreads), dynamic (first come first
+ *  served, the most expensive groups first) or balanced (measured cost
+ *  assignment + work stealing)
+ */
+enum schedule_type {static_schedule, dynamic_schedule, balanced_schedule};
+
+/** \fn bool schedule_type_from_string(const std::string& name, schedule_type& type)
+ *  \brief name of the command line (static, dynamic, balanced) to schedule_type
+ *  \return false if the name is unknown
+ */
+bool schedule_type_from_string(const std::string& name, schedule_type& type);
+
+} //end of namespace
+
+#endif
@@ -27,16 +27,37 @@
 #define MAPP_POOL_H_
 
 #include "coreneuron_1.0/event_passing/queueing/thread.h"
+#include "coreneuron_1.0/event_passing/queueing/options.h"
+#include "coreneuron_1.0/event_passing/queueing/ring.h"
 #include "coreneuron_1.0/event_passing/environment/generator.h"
 #include "coreneuron_1.0/event_passing/environment/presyn_maker.h"
 #include "coreneuron_1.0/event_passing/spike/spike_interface.h"
 #include "utils/storage/neuromapp_data.h"
+#include "utils/mpi/timeline.h"
 
 // Get OMP header if available
 #include "utils/omp/compatibility.h"
 
 namespace queueing {
 
+/**
+    \brief per thread spike exchange of fixed_step (MPI_THREAD_MULTIPLE):
+    every thread of the pool calls exchange once per fixed step, as soon as
+    the cell groups it has stepped are done, with their spikes. The spikes
+    are not merged in spike_interface::spikeout_, the implementation gives
+    the received spikes to spikein_ before filter.
+ */
+class thread_exchange {
+public:
+    virtual ~thread_exchange() {}
+
+    /** \fn exchange(int thread, std::vector<event>& spikes)
+     *  \brief called by the thread of fixed_step, concurrently with the
+     *  other threads, spikes can be swapped or cleared
+     */
+    virtual void exchange(int thread, std::vector<event>& spikes) = 0;
+};
+
 class pool {
 private:
     bool perform_algebra_;
@@ -45,24 +66,122 @@ private:
     int rank_;
     spike::spike_interface& spike_;
     std::vector<nrn_thread_data> thread_datas_;
+    inter_thread_type ite_;
+    /// spsc_ite: ring of the sender s to the receiver r in rings_[r*ngroups + s]
+    std::vector<spsc_ring<event>*> rings_;
+    /// spsc_ite: events popped from the rings, one buffer per receiver
+    std::vector<std::vector<event> > inbox_;
+
+    /// spikes of a cell group, padded to avoid false sharing between the groups
+    struct spike_buffer {
+        std::vector<event> events_;
+        char pad_[64];
+    };
+    /// no lock in send_events, merged in spike_.spikeout_ at the end of fixed_step
+    std::vector<spike_buffer> spikeout_;
+
+    schedule_type schedule_;
+    /// fixed steps between two assignments of the groups to the threads
+    int rebalance_;
+    int steps_;
+    int nthreads_;
+    /// time of every group since the last rebalance
+    std::vector<double> cost_;
+    /// dynamic_schedule: the groups by decreasing cost
+    std::vector<int> by_cost_;
+    /// balanced_schedule: the groups of the thread t in order_[first_[t], first_[t+1])
+    std::vector<int> order_;
+    std::vector<int> first_;
+
+    /// busy time of a thread in fixed_step and the cursor of its groups, padded
+    struct thread_clock {
+        thread_clock():busy_(0.),next_(0){}
+        double busy_;
+        int next_;
+        char pad_[64];
+    };
+    std::vector<thread_clock> clocks_;
+    /// time spent in the parallel regions of fixed_step
+    double wall_;
+    /// phases of the groups, NULL if no timeline
+    mapp::timeline* timeline_;
+    /// per thread exchange, NULL if the exchange is after fixed_step
+    thread_exchange* exchange_;
+    /// exchange_: the spikes of the groups stepped by a thread
+    std::vector<spike_buffer> thread_spikes_;
+
+    pool(const pool&);
+    pool& operator=(const pool&);
+
+    /** \fn receive_rings(const int myID)
+     *  \brief pop the rings of all the senders of myID without lock, and push
+     *  the events to my queue
+     */
+    void receive_rings(const int myID);
+
+    /** \fn merge_spikeout()
+     *  \brief copy the spikes of all the cell groups contiguously at the end of
+     *  spike_.spikeout_ (one block per group, in parallel) before the exchange
+     */
+    void merge_spikeout();
+
+    /** \fn step_group(const int myID)
+     *  \brief the (min_delay_) time steps of the cell group myID, timed in
+     *  cost_ and in the busy time of the calling thread
+     */
+    template <typename G, typename P>
+    void step_group(const int myID, G& generator, const P& presyns);
+
+    /** \fn send_spike(const int myID, const event& spike, const P& presyns)
+     *  \brief sends the spike of a gid of the group myID to the local targets
+     *  and to the spikeout_ buffer of the group
+     */
+    template <typename P>
+    void send_spike(const int myID, const event& spike, const P& presyns);
+
+    /** \fn exchange_thread(const int thread)
+     *  \brief gives the spikes of the groups stepped by thread to exchange_
+     */
+    void exchange_thread(const int thread);
+
+    /** \fn claim(const int thread)
+     *  \brief takes the next group of the list of thread, any thread can call
+     *  it (work stealing)
+     *  \return the group, -1 if the list is empty
+     */
+    int claim(const int thread);
+
+    /** \fn rebalance()
+     *  \brief sorts the groups by decreasing measured cost and assigns them
+     *  to the least loaded thread (longest processing time first), then
+     *  restarts the measure
+     */
+    void rebalance();
 
 public:
 
     /** \fn pool(bool algebra, int ngroups, int min_delay, int rank,
-     * spike_interface& s_interface)
+     * spike_interface& s_interface, queue_type type, inter_thread_type ite)
      *  \brief initializes a pool with a thread_datas_ array of size ngroups.
      *  \param algebra determines whether to perform linear algebra calculations
      *  \param ngroups the number of cell groups per node
      *  \param s_interface the spike interface used to communicate
      *  with the spike exchange algos
+     *  \param type the priority queue of the cell groups
+     *  \param ite the inter thread path, mutex (default) or spsc rings
+     *  \param schedule the scheduling of the groups on the threads
+     *  \param interval the number of fixed steps between two rebalances
      */
     pool(bool algebra, int ngroups, int md, int rank,
-    spike::spike_interface& s_interface): perform_algebra_(algebra),
-    min_delay_(md), time_(0), rank_(rank), spike_(s_interface)
-    {thread_datas_.resize(ngroups);}
+    spike::spike_interface& s_interface, queue_type type = binary_heap,
+    inter_thread_type ite = mutex_ite, schedule_type schedule = static_schedule,
+    int interval = 10);
+
+    ~pool();
 
     /** \fn send_events(const int myID, G& generator, const P& presyns)
-     *  \brief sends event to it's destination
+     *  \brief sends the events of the generator and the spikes detected by
+     *  the previous l_algebra of the group to their destination
      *  \param myID the thread index
      *  \param generator the event generator from which events are taken
      *  \param presyns contains the presyn information used to distribute
@@ -77,6 +196,10 @@ public:
      *      - events are enqueued
      *      - events are delivered
      *      - linear algebra is performed
+     *  then the spikes of the cell groups are merged in spikeout_, or given to
+     *  the thread_exchange by every thread at the end of its groups (once per
+     *  thread id of get_nthreads(), even if the team is smaller). The time
+     *  steps of a group are sequential, a group is the unit of scheduling
      *  \param generator the event generator from which events are taken
      *  \precond generator has been initialized
      *  \param presyns contains the presyn information used to distribute
@@ -103,6 +226,52 @@ public:
      */
     void accumulate_stats();
 
+    /** \fn watch(const std::vector<int>& gids, double threshold)
+     *  \brief the spikes of the gids come from the threshold crossings of
+     *  their compartment (the local index of the gid in nt_->_actual_v),
+     *  detected by l_algebra (algebra must be on)
+     *  \return the number of watched gids, the gids beyond the last
+     *  compartment are not watched
+     */
+    int watch(const std::vector<int>& gids, double threshold);
+
+    /** \fn step_stats(int& detected, double& compute, double& detect)
+     *  \brief the spikes detected by threshold, the time of l_algebra
+     *  without the detection and the time of the detection, summed over
+     *  the groups
+     */
+    void step_stats(int& detected, double& compute, double& detect) const;
+
+    /** \fn set_timeline(mapp::timeline* tl)
+     *  \brief records the send, enqueue, algebra and deliver phases of the
+     *  groups in tl (one ring per thread of fixed_step), NULL to stop
+     */
+    inline void set_timeline(mapp::timeline* tl) { timeline_ = tl; }
+
+    /** \fn set_thread_exchange(thread_exchange* x)
+     *  \brief every thread exchanges the spikes of its groups through x at
+     *  the end of fixed_step, NULL to merge them in spikeout_ (default)
+     */
+    inline void set_thread_exchange(thread_exchange* x) { exchange_ = x; }
+
+    /** \fn get_step_time()
+     *  \return the time spent in the parallel part of fixed_step
+     */
+    inline double get_step_time() const { return wall_; }
+
+    /** \fn record_trace(bool r)
+     *  \brief start/stop the recording of the inserts and dequeues of the
+     *  priority queue of every cell group
+     */
+    void record_trace(bool r);
+
+    /** \fn write_trace(const std::string& prefix)
+     *  \brief write the trace of every cell group in prefix_rank_group.trace
+     *  (binary, see coreneuron_1.0/queue/tool/trace.h)
+     *  \return false if a file can not be written
+     */
+    bool write_trace(const std::string& prefix) const;
+
 //GETTERS
     /** \fn get_ngroups()
      *  \return the number of cellgroups
@@ -113,6 +282,19 @@ public:
      * \return the current time_ value for this pool
      */
     inline int get_time() const { return time_; }
+
+    /** \fn get_nthreads()
+     *  \return the number of threads of fixed_step
+     */
+    inline int get_nthreads() const { return nthreads_; }
+
+    /** \fn idle_fraction(int thread)
+     *  \return the fraction of the time of fixed_step where thread had no
+     *  group to integrate
+     */
+    inline double idle_fraction(int thread) const {
+        return wall_ > 0. ? 1. - clocks_[thread].busy_/wall_ : 0.;
+    }
 };
 
 } //end of namespace
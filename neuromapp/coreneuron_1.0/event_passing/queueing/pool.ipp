@@ -29,45 +29,163 @@
 #include <fstream>
 #include <time.h>
 #include <ctime>
+#include <string>
+#include <sstream>
+#include <iterator>
+#include <algorithm>
+#include <utility>
 
 #ifndef MAPP_POOL_IPP_
 #define MAPP_POOL_IPP_
 
 namespace queueing {
 
+inline pool::pool(bool algebra, int ngroups, int md, int rank,
+spike::spike_interface& s_interface, queue_type type, inter_thread_type ite,
+schedule_type schedule, int interval):
+perform_algebra_(algebra), min_delay_(md), time_(0), rank_(rank), spike_(s_interface), ite_(ite),
+schedule_(schedule), rebalance_(std::max(interval, 1)), steps_(0),
+nthreads_(omp_get_max_threads()), wall_(0.), timeline_(NULL), exchange_(NULL){
+    thread_datas_.resize(ngroups, nrn_thread_data(type));
+    spikeout_.resize(ngroups);
+    cost_.resize(ngroups, 0.);
+    first_.resize(nthreads_ + 1);
+    clocks_.resize(nthreads_);
+    thread_spikes_.resize(nthreads_);
+    // no measure yet, round robin like static_schedule
+    rebalance();
+    if(ite_ == spsc_ite){
+        // 256 events (4 KB) per pair, a full ring falls back on the mutex path
+        rings_.resize(ngroups*ngroups);
+        for(int i = 0; i < rings_.size(); ++i)
+            rings_[i] = new spsc_ring<event>(256);
+        inbox_.resize(ngroups);
+    }
+}
+
+inline pool::~pool(){
+    for(int i = 0; i < rings_.size(); ++i)
+        delete rings_[i];
+}
+
+inline void pool::receive_rings(const int myID){
+    const int n = thread_datas_.size();
+    std::vector<event>& inbox = inbox_[myID];
+    inbox.clear();
+    for(int i = 0; i < n; ++i)
+        rings_[myID*n + i]->pop_all(std::back_inserter(inbox));
+    thread_datas_[myID].enqueue_events(inbox);
+}
+
+inline void pool::merge_spikeout(){
+    const int n = spikeout_.size();
+    std::vector<int> displ(n+1, spike_.spikeout_.size());
+    for(int i = 0; i < n; ++i)
+        displ[i+1] = displ[i] + spikeout_[i].events_.size();
+    spike_.spikeout_.resize(displ[n]);
+    spike_.spike_stats_ += displ[n] - displ[0];
+
+    #pragma omp parallel for schedule(static,1)
+    for(int i = 0; i < n; ++i){
+        std::copy(spikeout_[i].events_.begin(), spikeout_[i].events_.end(),
+                  spike_.spikeout_.begin() + displ[i]);
+        spikeout_[i].events_.clear();
+    }
+}
+
+inline void pool::exchange_thread(const int thread){
+    std::vector<event>& spikes = thread_spikes_[thread].events_;
+    #pragma omp atomic
+    spike_.spike_stats_ += spikes.size();
+    mapp::timeline_scope scope(timeline_, thread, mapp::exchange_phase);
+    exchange_->exchange(thread, spikes);
+    spikes.clear();
+}
+
+inline int pool::claim(const int thread){
+#if defined(__GNUC__)
+    const int k = __sync_fetch_and_add(&clocks_[thread].next_, 1);
+#else
+    int k;
+    #pragma omp critical(pool_claim)
+    k = clocks_[thread].next_++;
+#endif
+    return (k < first_[thread+1] - first_[thread]) ? order_[first_[thread] + k] : -1;
+}
+
+/** \fn heavier(const std::pair<double,int>& a, const std::pair<double,int>& b)
+ *  \brief decreasing cost, then increasing group
+ */
+inline bool heavier(const std::pair<double,int>& a, const std::pair<double,int>& b){
+    return a.first > b.first || (a.first == b.first && a.second < b.second);
+}
+
+inline void pool::rebalance(){
+    const int n = thread_datas_.size();
+    std::vector<std::pair<double,int> > groups(n);
+    for(int i = 0; i < n; ++i){
+        groups[i] = std::make_pair(cost_[i], i);
+        cost_[i] = 0.;
+    }
+    std::sort(groups.begin(), groups.end(), heavier);
+
+    //longest processing time first, ties to the thread with the fewest groups
+    std::vector<double> load(nthreads_, 0.);
+    std::vector<std::vector<int> > mine(nthreads_);
+    by_cost_.resize(n);
+    for(int k = 0; k < n; ++k){
+        int t = 0;
+        for(int j = 1; j < nthreads_; ++j)
+            if(load[j] < load[t] || (load[j] == load[t] && mine[j].size() < mine[t].size()))
+                t = j;
+        load[t] += groups[k].first;
+        mine[t].push_back(groups[k].second);
+        by_cost_[k] = groups[k].second;
+    }
+    order_.clear();
+    first_[0] = 0;
+    for(int t = 0; t < nthreads_; ++t){
+        order_.insert(order_.end(), mine[t].begin(), mine[t].end());
+        first_[t+1] = order_.size();
+    }
+}
+
+template<typename P>
+inline void pool::send_spike(const int myID, const event& spike, const P& presyns){
+    const environment::presyn* output = presyns.find_output(spike.data_);
+    if(output == NULL){
+        std::cout<<"Rank: "<<rank_<<" Could not find gid: "<<spike.data_<<std::endl;
+        assert(false);
+    }
+    //send to all local destinations
+    for(int i = 0; i < output->size(); ++i){
+        const int dest = (*output)[i] % thread_datas_.size();
+        if(dest == myID)
+            thread_datas_[myID].self_send(spike.data_, spike.t_);
+        else if(ite_ == mutex_ite ||
+                !rings_[dest*thread_datas_.size() + myID]->push(spike))
+            thread_datas_[dest].inter_thread_send(spike.data_, spike.t_);
+    }
+    //send to the spikeout_ buffer of my cell group, no lock
+    spikeout_[myID].events_.push_back(spike);
+}
+
 template<typename G, typename P>
 void pool::send_events(const int myID, G& generator, const P& presyns){
     int curTime = thread_datas_[myID].get_time();
-    int gid = 0;
-    int dest;
-    const environment::presyn* output = NULL;
     event new_event;
     try{
         while(generator.compare_top_lte(myID, curTime)){
             environment::gen_event g = generator.pop(myID);
-            gid = g.first;
-            output = presyns.find_output(gid);
-            if(output == NULL){
-                std::cout<<"Rank: "<<rank_<<" Could not find gid: "<<gid<<std::endl;
-                assert(false);
-            }
-            //send to all local destinations
-            for(int i = 0; i < output->size(); ++i){
-                dest = (*output)[i] % thread_datas_.size();
-                if(dest == myID)
-                    thread_datas_[myID].self_send(gid, g.second);
-                else
-                    thread_datas_[dest].inter_thread_send(gid, g.second);
-            }
-            //send to spikeout_ buffer
-            new_event.data_ = gid;
+            new_event.data_ = g.first;
             new_event.t_ = g.second;
-
-            spike_.lock_.lock();
-            spike_.spikeout_.push_back(new_event);
-            ++(spike_.spike_stats_);
-            spike_.lock_.unlock();
+            send_spike(myID, new_event, presyns);
         }
+        //the threshold crossings of the previous l_algebra
+        std::vector<event>& detected = thread_datas_[myID].detected();
+        for(int i = 0; i < detected.size(); ++i)
+            send_spike(myID, detected[i], presyns);
+        detected.clear();
     }
     catch(const std::bad_alloc& e) {
         std::cout <<"send failed: "<<e.what()<<std::endl;
@@ -76,23 +194,89 @@ void pool::send_events(const int myID, G& generator, const P& presyns){
 
 //PARALLEL FUNCTIONS
 template <typename G, typename P>
-void pool::fixed_step(G& generator, const P& presyns){
-    #pragma omp parallel for schedule(static,1)
-    for(int i = 0; i < thread_datas_.size(); ++i){
-        for(int j = 0; j < min_delay_; ++j){
-            send_events(i, generator, presyns);
+void pool::step_group(const int myID, G& generator, const P& presyns){
+    const int thread = omp_get_thread_num();
+    const double t0 = omp_get_wtime();
+    for(int j = 0; j < min_delay_; ++j){
+        {
+            mapp::timeline_scope scope(timeline_, thread, mapp::send_phase);
+            send_events(myID, generator, presyns);
+        }
+        {
             //Have threads enqueue their interThreadEvents
-            thread_datas_[i].enqueue_my_events();
-
-            if(perform_algebra_)
-                thread_datas_[i].l_algebra();
-
+            mapp::timeline_scope scope(timeline_, thread, mapp::enqueue_phase);
+            thread_datas_[myID].enqueue_my_events();
+            if(ite_ == spsc_ite)
+                receive_rings(myID);
+        }
+        if(perform_algebra_){
+            mapp::timeline_scope scope(timeline_, thread, mapp::algebra_phase);
+            thread_datas_[myID].l_algebra();
+        }
+        {
             /// Deliver events
-            while(thread_datas_[i].deliver());
+            mapp::timeline_scope scope(timeline_, thread, mapp::deliver_phase);
+            thread_datas_[myID].deliver_all();
+        }
+        thread_datas_[myID].increment_time();
+    }
+    const double dt = omp_get_wtime() - t0;
+    cost_[myID] += dt;
+    clocks_[thread].busy_ += dt;
+    if(exchange_){
+        std::vector<event>& spikes = spikeout_[myID].events_;
+        thread_spikes_[thread].events_.insert(thread_spikes_[thread].events_.end(),
+                                              spikes.begin(), spikes.end());
+        spikes.clear();
+    }
+}
 
-            thread_datas_[i].increment_time();
+template <typename G, typename P>
+void pool::fixed_step(G& generator, const P& presyns){
+    const int n = thread_datas_.size();
+    const double t0 = omp_get_wtime();
+    if(schedule_ == balanced_schedule){
+        for(int t = 0; t < nthreads_; ++t)
+            clocks_[t].next_ = 0;
+    }
+    #pragma omp parallel num_threads(nthreads_)
+    {
+        const int me = omp_get_thread_num();
+        switch(schedule_){
+            case static_schedule :
+                #pragma omp for schedule(static,1) nowait
+                for(int i = 0; i < n; ++i)
+                    step_group(i, generator, presyns);
+                break;
+            case dynamic_schedule :
+                #pragma omp for schedule(dynamic,1) nowait
+                for(int k = 0; k < n; ++k)
+                    step_group(by_cost_[k], generator, presyns);
+                break;
+            case balanced_schedule :
+                //my groups first, then the groups left by the others
+                for(int k = 0; k < nthreads_; ++k){
+                    const int victim = (me + k) % nthreads_;
+                    int group;
+                    while((group = claim(victim)) >= 0)
+                        step_group(group, generator, presyns);
+                }
+                break;
+        }
+        //no barrier, my spikes leave while the others step
+        if(exchange_){
+            exchange_thread(me);
+            //a smaller team (OMP_DYNAMIC, thread limit): the ids without a
+            //thread join their collectives empty, in increasing order
+            const int team = omp_get_num_threads();
+            for(int t = me + team; t < nthreads_; t += team)
+                exchange_thread(t);
         }
     }
+    wall_ += omp_get_wtime() - t0;
+    if(schedule_ != static_schedule && ++steps_ % rebalance_ == 0)
+        rebalance();
+    merge_spikeout();
     time_ += min_delay_;
 }
 
@@ -108,6 +292,7 @@ void pool::filter(const P& presyns){
             tt = spike_.spikein_[i].t_;
             spike_gid = spike_.spikein_[i].data_;
             if((input = presyns.find_input(spike_gid)) != NULL){
+                ++(spike_.filter_hits_);
                 for(size_t j = 0; j < input->size(); ++j){
                     dest = (*input)[j] % thread_datas_.size();
                     //send using non-mutex inter-thread send here
@@ -140,6 +325,44 @@ inline void pool::accumulate_stats(){
     spike_.local_stats_ = local_stats;
 }
 
+inline int pool::watch(const std::vector<int>& gids, double threshold){
+    //the local index of the gid is its compartment, all the groups share the
+    //data of the cstep miniapp
+    int n = 0;
+    for(int k = 0; k < gids.size(); ++k){
+        nrn_thread_data& d = thread_datas_[gids[k] % thread_datas_.size()];
+        d.set_threshold(threshold);
+        n += d.watch(gids[k], k);
+    }
+    return n;
+}
+
+inline void pool::step_stats(int& detected, double& compute, double& detect) const{
+    detected = 0;
+    compute = 0.;
+    detect = 0.;
+    for(int i=0; i < thread_datas_.size(); ++i){
+        detected += thread_datas_[i].detected_stats_;
+        compute += thread_datas_[i].compute_time_;
+        detect += thread_datas_[i].detect_time_;
+    }
+}
+
+inline void pool::record_trace(bool r){
+    for(int i=0; i < thread_datas_.size(); ++i)
+        thread_datas_[i].record(r);
+}
+
+inline bool pool::write_trace(const std::string& prefix) const{
+    bool ok = true;
+    for(int i=0; i < thread_datas_.size(); ++i){
+        std::stringstream file;
+        file << prefix << "_" << rank_ << "_" << i << ".trace";
+        ok = tool::write_trace(file.str(), thread_datas_[i].trace()) && ok;
+    }
+    return ok;
+}
+
 } //end of namespace
 
 #endif
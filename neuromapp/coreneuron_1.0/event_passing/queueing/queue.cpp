@@ -33,18 +33,121 @@
 
 namespace queueing {
 
-void queue::insert(double tt, int d) {
-    event e(d,tt);
-    pq_que.push(e);
+bool queue_type_from_string(const std::string& name, queue_type& type){
+    std::map<std::string,queue_type> m;
+    m.insert(std::make_pair("heap",binary_heap));
+    m.insert(std::make_pair("radix",radix_heap));
+    m.insert(std::make_pair("sptq",sptq));
+    m.insert(std::make_pair("bin",bin));
+    m.insert(std::make_pair("ladder",ladder));
+    std::map<std::string,queue_type>::const_iterator it = m.find(name);
+    if(it == m.end())
+        return false;
+    type = it->second;
+    return true;
 }
 
-bool queue::atomic_dq(double tt, event& q) {
-    if(!pq_que.empty() && pq_que.top().t_ <= tt) {
-        q = pq_que.top();
-        pq_que.pop();
+queue::queue(queue_type type){
+    switch(type){
+        case radix_heap :
+            backend_ = new tool_backend<tool::radix_queue<event> >();
+            break;
+        case sptq :
+            backend_ = new tool_backend<tool::sptq_queue<event, std::greater<event> > >();
+            break;
+        case bin :
+            // the times are integer steps, one bin per step
+            backend_ = new tool_backend<tool::bin_queue<event> >(tool::bin_queue<event>(1.));
+            break;
+        case ladder :
+            backend_ = new tool_backend<tool::ladder_queue<event> >();
+            break;
+        default :
+            backend_ = new heap_backend();
+    }
+}
+
+queue::queue(const queue& other):backend_(other.backend_->clone()){}
+
+queue& queue::operator=(const queue& other){
+    if(this != &other){
+        queue_backend* b = other.backend_->clone();
+        delete backend_;
+        backend_ = b;
+    }
+    return *this;
+}
+
+queue::~queue(){
+    delete backend_;
+}
+
+void heap_backend::insert(const event& e) {
+    heap_.push_back(e);
+    std::push_heap(heap_.begin(), heap_.end(), std::greater<event>());
+}
+
+bool heap_backend::atomic_dq(double tt, event& q) {
+    if(!heap_.empty() && heap_.front().t_ <= tt) {
+        std::pop_heap(heap_.begin(), heap_.end(), std::greater<event>());
+        q = heap_.back();
+        heap_.pop_back();
         return true;
     }
     return false;
 }
 
+void heap_backend::drain_until(double til, std::vector<event>& out){
+    const size_t n = heap_.size();
+    const size_t k = count_until(til);
+    if(k == 0)
+        return;
+
+    size_t log_n = 1;
+    while((size_t(1) << log_n) < n)
+        ++log_n;
+
+    if(k*log_n < n){
+        for(size_t i = 0; i < k; ++i){
+            std::pop_heap(heap_.begin(), heap_.end(), std::greater<event>());
+            out.push_back(heap_.back());
+            heap_.pop_back();
+        }
+    }else{
+        std::vector<event>::iterator it = std::partition(heap_.begin(), heap_.end(), event_until(til));
+        std::sort(heap_.begin(), it, event_less());
+        out.insert(out.end(), heap_.begin(), it);
+        heap_.erase(heap_.begin(), it);
+        std::make_heap(heap_.begin(), heap_.end(), std::greater<event>());
+    }
+}
+
+void heap_backend::push_bulk(const std::vector<event>& v){
+    const size_t n = heap_.size();
+    heap_.insert(heap_.end(), v.begin(), v.end());
+    if(v.size() >= n){
+        std::make_heap(heap_.begin(), heap_.end(), std::greater<event>());
+    }else{
+        for(size_t i = n; i < heap_.size(); ++i)
+            std::push_heap(heap_.begin(), heap_.begin() + i + 1, std::greater<event>());
+    }
+}
+
+size_t heap_backend::count_until(double til) const {
+    // the events <= til are a subtree of the heap containing the root
+    size_t k = 0;
+    if(heap_.empty() || heap_[0].t_ > til)
+        return k;
+    std::vector<size_t> stack(1,0);
+    while(!stack.empty()){
+        size_t i = stack.back();
+        stack.pop_back();
+        ++k;
+        for(size_t c = 2*i + 1; c <= 2*i + 2 && c < heap_.size(); ++c)
+            if(!(heap_[c].t_ > til))
+                stack.push_back(c);
+    }
+    return k;
+}
+
 } //end of namespace
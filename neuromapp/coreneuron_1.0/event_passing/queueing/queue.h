@@ -30,13 +30,27 @@
 #include <map>
 #include <utility>
 #include <functional>
-
+#include <algorithm>
+#include <iterator>
 
 #ifndef MAPP_CONTAINER_H_
 #define MAPP_CONTAINER_H_
 
+#include <string>
+
+#include "coreneuron_1.0/queue/tool/priority_queue.hpp"
+
 namespace queueing {
 
+/** the priority queue of a nrn_thread_data, selected at run time */
+enum queue_type {binary_heap, radix_heap, sptq, bin, ladder};
+
+/** \fn bool queue_type_from_string(const std::string& name, queue_type& type)
+ *  \brief name of the command line (heap, radix, sptq, bin, ladder) to queue_type
+ *  \return false if the name is unknown
+ */
+bool queue_type_from_string(const std::string& name, queue_type& type);
+
 struct event {
     explicit event(int d = 0, double t = 0.):data_(d),t_(t){};
     int data_;
@@ -50,12 +64,128 @@ struct event {
     }
 };
 
+/** \fn double time_of(const event& e)
+ *  \brief the time of an event for the queues of coreneuron_1.0/queue/tool (ADL)
+ */
+inline double time_of(const event& e){
+    return e.t_;
+}
+
+/** predicate for the partition of drain_until */
+struct event_until {
+    explicit event_until(double til):til_(til){}
+    inline bool operator()(const event& e) const {
+        return !(e.t_ > til_);
+    }
+    double til_;
+};
+
+/** order of the drained events */
+struct event_less {
+    inline bool operator()(const event& a, const event& b) const {
+        return a.t_ < b.t_;
+    }
+};
+
+/** interface of the backends of the queue, the bulk functions work on a
+ *  std::vector so the virtual call is paid once per bulk
+ */
+class queue_backend {
+public:
+    virtual ~queue_backend(){}
+    virtual queue_backend* clone() const = 0;
+    virtual size_t size() const = 0;
+    virtual void insert(const event& e) = 0;
+    virtual bool atomic_dq(double til, event& q) = 0;
+    virtual void drain_until(double til, std::vector<event>& out) = 0;
+    virtual void push_bulk(const std::vector<event>& v) = 0;
+};
+
+/** binary heap in a std::vector, smallest time on top, std::push_heap/pop_heap
+ *  with std::greater
+ */
+class heap_backend : public queue_backend {
+public:
+    queue_backend* clone() const {return new heap_backend(*this);}
+    size_t size() const {return heap_.size();}
+    void insert(const event& e);
+    bool atomic_dq(double til, event& q);
+
+    /** The events <= til are a subtree of the heap containing the root, they are
+     *  counted in O(k). If k is small they are popped one by one (k log n), else
+     *  they are partitioned, sorted and the heap is rebuilt (n + k log k).
+     */
+    void drain_until(double til, std::vector<event>& out);
+
+    /** If the range is as large as the heap, the heap is rebuilt in O(n + k),
+     *  else the events are pushed one by one.
+     */
+    void push_bulk(const std::vector<event>& v);
+
+private:
+    /** \fn size_t count_until(double til) const
+     *  \return the number of events with time <= til
+     */
+    size_t count_until(double til) const;
+
+    std::vector<event> heap_;
+};
+
+/** a queue of coreneuron_1.0/queue/tool, std::priority_queue API with std::greater
+ *  plus the native drain_until/push_bulk
+ */
+template<class Q>
+class tool_backend : public queue_backend {
+public:
+    explicit tool_backend(const Q& q = Q()):q_(q){}
+    queue_backend* clone() const {return new tool_backend(*this);}
+    size_t size() const {return q_.size();}
+
+    void insert(const event& e){
+        q_.push(e);
+    }
+
+    bool atomic_dq(double til, event& q){
+        if(!q_.empty() && q_.top().t_ <= til){
+            q = q_.top();
+            q_.pop();
+            return true;
+        }
+        return false;
+    }
+
+    void drain_until(double til, std::vector<event>& out){
+        tool::drain_until(q_, event(0,til), std::back_inserter(out));
+    }
+
+    void push_bulk(const std::vector<event>& v){
+        tool::push_bulk(q_, v.begin(), v.end());
+    }
+
+private:
+    Q q_;
+};
+
 class queue {
 public:
+    /** \fn queue(queue_type type)
+     *  \brief creates an empty queue
+     *  \param type the backend: binary_heap (default), radix_heap (monotone
+     *  radix heap, the events earlier than the last delivered one are due now),
+     *  sptq (splay tree), bin (bin_queue, one bin per time step) or ladder
+     */
+    explicit queue(queue_type type = binary_heap);
+
+    queue(const queue& other);
+
+    queue& operator=(const queue& other);
+
+    ~queue();
+
     /** \fn size()
-     *  \return the size of pq_que
+     *  \return the size of the queue
      */
-    size_t size() const {return pq_que.size();}
+    size_t size() const {return backend_->size();}
 
     /** \fn Event* atomic_dq(double til, event q)
      *  \brief pops a single event off of the queue with time < til
@@ -63,17 +193,60 @@ public:
      *  \param q is assigned to the popped event.
      *  \return true if popped, else false
      */
-    bool atomic_dq(double til, event& q);
+    bool atomic_dq(double til, event& q){
+        return backend_->atomic_dq(til, q);
+    }
 
     /** \fn void insert(double t, int data)
      *  \brief inserts an event with time t and data value
      *  \param t the event time.
      *  \param data the event data.
      */
-    void insert(double t, int data);
+    void insert(double t, int data){
+        backend_->insert(event(data,t));
+    }
+
+    /** \fn void drain_until(double til, std::vector<event>& out)
+     *  \brief pops all the events with time <= til, in time order
+     *  \param til a double value compared against the event times.
+     *  \param out the popped events are appended to out.
+     */
+    void drain_until(double til, std::vector<event>& out){
+        backend_->drain_until(til, out);
+    }
+
+    /** \fn OutputIt drain_until(double til, OutputIt out)
+     *  \brief idem, the events are copied in out
+     *  \return out after the last popped event
+     */
+    template<class OutputIt>
+    OutputIt drain_until(double til, OutputIt out){
+        buffer_.clear();
+        backend_->drain_until(til, buffer_);
+        return std::copy(buffer_.begin(), buffer_.end(), out);
+    }
+
+    /** \fn void push_bulk(const std::vector<event>& v)
+     *  \brief inserts all the events of v
+     */
+    void push_bulk(const std::vector<event>& v){
+        backend_->push_bulk(v);
+    }
+
+    /** \fn void push_bulk(InputIt first, InputIt last)
+     *  \brief inserts a range of events
+     *  \param first begin of the range
+     *  \param last end of the range
+     */
+    template<class InputIt>
+    void push_bulk(InputIt first, InputIt last){
+        buffer_.assign(first, last);
+        backend_->push_bulk(buffer_);
+    }
 
 private:
-    std::priority_queue<event, std::vector<event>, std::greater<event> > pq_que;
+    queue_backend* backend_;
+    std::vector<event> buffer_; // for the ranges
 };
 
 } //end of namespace
@@ -0,0 +1,129 @@
+/*
+ * Neuromapp - ring.h, Copyright (c), 2015,
+ * Kai Langen - Swiss Federal Institute of technology in Lausanne,
+ * kai.langen@epfl.ch,
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.
+ */
+
+/**
+ * @file neuromapp/coreneuron_1.0/event_passing/queueing/ring.h
+ * \brief Contains the lock free single producer/single consumer ring buffer
+ */
+
+#ifndef MAPP_RING_H_
+#define MAPP_RING_H_
+
+#include <vector>
+#include <cstddef>
+
+namespace queueing {
+
+#if defined(__GNUC__)
+/** \fn ring_load(const std::size_t& x)
+ *  \brief load with acquire semantic, the writes before the matching
+ *  ring_store of the other thread are visible
+ */
+inline std::size_t ring_load(const std::size_t& x){
+    return __atomic_load_n(&x, __ATOMIC_ACQUIRE);
+}
+
+/** \fn ring_store(std::size_t& x, std::size_t v)
+ *  \brief store with release semantic
+ */
+inline void ring_store(std::size_t& x, std::size_t v){
+    __atomic_store_n(&x, v, __ATOMIC_RELEASE);
+}
+#else
+inline std::size_t ring_load(const std::size_t& x){
+    std::size_t v = *static_cast<const volatile std::size_t*>(&x);
+    #pragma omp flush
+    return v;
+}
+
+inline void ring_store(std::size_t& x, std::size_t v){
+    #pragma omp flush
+    *static_cast<volatile std::size_t*>(&x) = v;
+}
+#endif
+
+/**
+    \brief bounded ring buffer for one producer thread and one consumer thread,
+    without any lock. The producer only writes tail_, the consumer only writes
+    head_, the counters are never wrapped (the position is counter & mask_).
+    push fails when the ring is full, the caller falls back on another path.
+ */
+template<class T>
+class spsc_ring{
+public:
+    /** \fn spsc_ring(std::size_t capacity)
+     *  \brief the capacity is rounded up to a power of 2
+     */
+    explicit spsc_ring(std::size_t capacity = 256): head_(0), tail_(0){
+        std::size_t n = 1;
+        while(n < capacity)
+            n <<= 1;
+        buffer_.resize(n);
+        mask_ = n - 1;
+    }
+
+    /** \fn bool push(const T& v)
+     *  \brief producer side
+     *  \return false if the ring is full
+     */
+    inline bool push(const T& v){
+        const std::size_t tail = tail_;
+        if(tail - ring_load(head_) == buffer_.size())
+            return false;
+        buffer_[tail & mask_] = v;
+        ring_store(tail_, tail + 1);
+        return true;
+    }
+
+    /** \fn OutputIt pop_all(OutputIt out)
+     *  \brief consumer side, copy all the pushed elements in out
+     */
+    template<class OutputIt>
+    OutputIt pop_all(OutputIt out){
+        const std::size_t head = head_;
+        const std::size_t tail = ring_load(tail_);
+        for(std::size_t i = head; i != tail; ++i)
+            *out++ = buffer_[i & mask_];
+        ring_store(head_, tail);
+        return out;
+    }
+
+    /** \fn size_t capacity()
+     *  \return the max number of elements
+     */
+    std::size_t capacity() const {return buffer_.size();}
+
+private:
+    spsc_ring(const spsc_ring&);
+    spsc_ring& operator=(const spsc_ring&);
+
+    // head_ and tail_ on their own cache line, no false sharing
+    char pad0_[64];
+    std::size_t head_;
+    char pad1_[64];
+    std::size_t tail_;
+    char pad2_[64];
+    std::size_t mask_;
+    std::vector<T> buffer_;
+};
+
+} //end of namespace
+
+#endif
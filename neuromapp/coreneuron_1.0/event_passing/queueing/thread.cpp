@@ -33,8 +33,9 @@
 
 namespace queueing {
 
-nrn_thread_data::nrn_thread_data():
-ite_received_(0), local_received_(0), enqueued_(0), delivered_(0) {
+nrn_thread_data::nrn_thread_data(queue_type type):
+qe_(type), record_(false), threshold_(-50.), weight_(2.), ite_received_(0), local_received_(0),
+enqueued_(0), delivered_(0), detected_stats_(0), compute_time_(0.), detect_time_(0.) {
     input_parameters p;
     time_ = 0;
     char name[] = "coreneuron_1.0_queueing_data";
@@ -57,6 +58,8 @@ void nrn_thread_data::self_send(int d, double tt){
     ++enqueued_;
     ++local_received_;
     qe_.insert(tt, d);
+    if(record_)
+        trace_.push_back(tool::trace_record(tool::trace_push, tt));
 }
 
 void nrn_thread_data::inter_thread_send(int d, double tt){
@@ -78,20 +81,30 @@ void nrn_thread_data::inter_send_no_lock(int d, double tt){
 
 void nrn_thread_data::enqueue_my_events(){
     lock_.lock();
-    event ite;
-    for(int i = 0; i < inter_thread_events_.size(); ++i){
-        ite = inter_thread_events_[i];
-        ++enqueued_;
-        qe_.insert(ite.t_, ite.data_);
-    }
+    enqueued_ += inter_thread_events_.size();
+    qe_.push_bulk(inter_thread_events_);
+    if(record_)
+        for(int i = 0; i < inter_thread_events_.size(); ++i)
+            trace_.push_back(tool::trace_record(tool::trace_push, inter_thread_events_[i].t_));
     inter_thread_events_.clear();
     lock_.unlock();
 }
 
+void nrn_thread_data::enqueue_events(const std::vector<event>& events){
+    ite_received_ += events.size();
+    enqueued_ += events.size();
+    qe_.push_bulk(events);
+    if(record_)
+        for(int i = 0; i < events.size(); ++i)
+            trace_.push_back(tool::trace_record(tool::trace_push, events[i].t_));
+}
+
 bool nrn_thread_data::deliver(){
     event q;
     if(qe_.atomic_dq(time_, q)){
         ++delivered_;
+        if(record_)
+            trace_.push_back(tool::trace_record(tool::trace_pop, time_));
 
         // Use imitation of the point_receive of CoreNeron.
         // Varies per a specific simulation case.
@@ -102,7 +115,28 @@ bool nrn_thread_data::deliver(){
     return false;
 }
 
+int nrn_thread_data::deliver_all(){
+    deliver_buffer_.clear();
+    qe_.drain_until(time_, deliver_buffer_);
+    if(record_)
+        trace_.push_back(tool::trace_record(tool::trace_drain, time_));
+    const int n = deliver_buffer_.size();
+    for(int i = 0; i < n; ++i)
+        mech_net_receive(nt_,&(nt_->ml[18])); // see deliver
+    //the synapses of an event are on a watched compartment given by its source
+    if(!watch_nodes_.empty()){
+        const unsigned int nwatch = watch_nodes_.size();
+        for(int i = 0; i < n; ++i){
+            const unsigned int k = (static_cast<unsigned int>(deliver_buffer_[i].data_)*2654435761u) % nwatch;
+            nt_->_actual_v[watch_nodes_[k]] += weight_;
+        }
+    }
+    delivered_ += n;
+    return n;
+}
+
 void nrn_thread_data::l_algebra(){
+    const double t0 = omp_get_wtime();
     nt_->_t = static_cast<double>(time_);
 
        //Update the current
@@ -117,6 +151,35 @@ void nrn_thread_data::l_algebra(){
     mech_state_NaTs2_t(nt_,&(nt_->ml[17]));
     mech_state_Ih(nt_,&(nt_->ml[10]));
     mech_state_ProbAMPANMDA_EMS(nt_,&(nt_->ml[18]));
+    const double t1 = omp_get_wtime();
+    compute_time_ += t1 - t0;
+
+    if(!watch_nodes_.empty()){
+        detect();
+        detect_time_ += omp_get_wtime() - t1;
+    }
+}
+
+bool nrn_thread_data::watch(int gid, int node){
+    if(node < 0 || node >= nt_->end)
+        return false;
+    watch_gids_.push_back(gid);
+    watch_nodes_.push_back(node);
+    watch_rest_.push_back(nt_->_actual_v[node]);
+    return true;
+}
+
+void nrn_thread_data::detect(){
+    double* v = nt_->_actual_v;
+    for(int k = 0; k < watch_nodes_.size(); ++k){
+        const int node = watch_nodes_[k];
+        v[node] = watch_rest_[k] + 0.9*(v[node] - watch_rest_[k]);
+        if(v[node] >= threshold_){
+            detected_.push_back(event(watch_gids_[k], static_cast<double>(time_)));
+            ++detected_stats_;
+            v[node] = watch_rest_[k];
+        }
+    }
 }
 
 } //endnamespace
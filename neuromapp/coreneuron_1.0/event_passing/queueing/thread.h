@@ -36,6 +36,7 @@
 #include "utils/storage/storage.h"
 
 #include "coreneuron_1.0/event_passing/queueing/queue.h"
+#include "coreneuron_1.0/queue/tool/trace.h"
 #include "coreneuron_1.0/common/data/helper.h"
 
 // Get OMP header if available
@@ -52,19 +53,34 @@ private:
     NrnThread* nt_;
     /// vector for inter thread events
     std::vector<event> inter_thread_events_;
+    /// buffer of the events delivered by deliver_all
+    std::vector<event> deliver_buffer_;
+    /// trace of the operations on qe_, if record_
+    bool record_;
+    std::vector<tool::trace_record> trace_;
+    /// threshold detection: the gids of the watched compartments of nt_->_actual_v
+    std::vector<int> watch_gids_;
+    std::vector<int> watch_nodes_;
+    std::vector<double> watch_rest_;
+    double threshold_;
+    double weight_;
+    /// spikes detected by l_algebra, sent by the pool at the next time step
+    std::vector<event> detected_;
 public:
     int ite_received_;
     int local_received_;
     int enqueued_;
     int delivered_;
     int time_;
+    int detected_stats_;
+    double compute_time_; // l_algebra without the detection
+    double detect_time_;
 
-    /** \fn nrn_thread_data()
+    /** \fn nrn_thread_data(queue_type type)
      *  \brief initializes nrn_thread_data and creates a new priority queue
-     *  \param i provides the thread id for this nrn_thread_data
-     *   \param verbose verbose mode: 1 = ON, 0 = OFF
+     *  \param type the backend of the priority queue, binary heap by default
      */
-    nrn_thread_data();
+    explicit nrn_thread_data(queue_type type = binary_heap);
 
     /** \fn void self_send(int d, double tt)
      *  \brief send an item directly to my priority queue
@@ -93,6 +109,12 @@ public:
      */
     void enqueue_my_events();
 
+    /** \fn void enqueue_events(const std::vector<event>& events)
+     *  \brief push the inter thread events received without lock (spsc
+     *  rings of the pool) to my priority queue, called by my own thread
+     */
+    void enqueue_events(const std::vector<event>& events);
+
     /** \fn bool deliver(int id, int til)
      *  \brief dequeue all items with time < til
      *  \param id used in sanity check to verify destination
@@ -101,11 +123,43 @@ public:
      */
     bool deliver();
 
+    /** \fn int deliver_all()
+     *  \brief dequeue all items with time <= time_ in one drain of the queue
+     *  \return the number of delivered events
+     */
+    int deliver_all();
+
     /** \fn void l_algebra()
-     *  \brief performs the mechanism calculations/updates for linear algebra
+     *  \brief performs the mechanism calculations/updates for linear algebra,
+     *  then the threshold detection if compartments are watched
      */
     void l_algebra();
 
+    /** \fn bool watch(int gid, int node)
+     *  \brief the compartment node of nt_->_actual_v is the soma of gid, its
+     *  threshold crossings are detected by l_algebra
+     *  \return false if node is not a compartment
+     */
+    bool watch(int gid, int node);
+
+    /** \fn void set_threshold(double threshold, double weight)
+     *  \brief a watched compartment spikes when its voltage reaches threshold
+     *  (mV), a delivered event raises the voltage of weight (mV)
+     */
+    void set_threshold(double threshold, double weight = 2.) {threshold_ = threshold; weight_ = weight;}
+
+    /** \fn void detect()
+     *  \brief the voltage of the watched compartments relaxes to the rest
+     *  (time constant 10 steps), a compartment above the threshold spikes
+     *  (in detected_) and is reset to the rest
+     */
+    void detect();
+
+    /** \fn std::vector<event>& detected()
+     *  \return the spikes detected since the last send, data_ is the gid
+     */
+    std::vector<event>& detected() {return detected_;}
+
     /** \fn size_t inter_thread_size()
      *  \return the size of inter_thread_events_
      */
@@ -121,6 +175,17 @@ public:
      */
     int get_time() const {return time_;}
 
+    /** \fn void record(bool r)
+     *  \brief start/stop the recording of the inserts and dequeues of the
+     *  priority queue (replayed by the trace benchmark of the queue miniapp)
+     */
+    void record(bool r) {record_ = r;}
+
+    /** \fn const std::vector<tool::trace_record>& trace() const
+     *  \return the recorded trace
+     */
+    const std::vector<tool::trace_record>& trace() const {return trace_;}
+
     /** \fn increment_time()
      *  \brief increments thread time by 1
      */
@@ -63,6 +63,35 @@ inline MPI_Datatype create_spike_type(){
     return spike;
 }
 
+/**
+ * \fn create_compact_spike_type()
+ * \brief creates the MPI_Datatype of the compact wire format (8 bytes)
+ * \return the new MPI_Datatype
+ */
+inline MPI_Datatype create_compact_spike_type(){
+    MPI_Datatype compact;
+    int blocklengths[2] = {1,1};
+    MPI_Datatype types[2] = {MPI_INT, MPI_FLOAT};
+    MPI_Aint offsets[2];
+
+    offsets[0] = offsetof(spike::compact_spike, gid_);
+    offsets[1] = offsetof(spike::compact_spike, dt_);
+
+    MPI_Type_create_struct(2, blocklengths, offsets, types, &compact);
+    MPI_Type_commit(&compact);
+    return compact;
+}
+
+/**
+ * \fn wire_size(MPI_Datatype type)
+ * \return the number of bytes of an element of type on the wire
+ */
+inline int wire_size(MPI_Datatype type){
+    int size;
+    MPI_Type_size(type, &size);
+    return size;
+}
+
 /**
  * \fn barrier()
  * \brief performs an MPI_Barrier
@@ -165,6 +194,8 @@ void accumulate_stats(data& d){
         MPI_Reduce(MPI_IN_PLACE, &(d.local_stats_), 1, MPI_INT, MPI_SUM, 0, MPI_COMM_WORLD);
         MPI_Reduce(MPI_IN_PLACE, &(d.post_spike_stats_), 1, MPI_INT, MPI_SUM, 0, MPI_COMM_WORLD);
         MPI_Reduce(MPI_IN_PLACE, &(d.received_spike_stats_), 1, MPI_INT, MPI_SUM, 0, MPI_COMM_WORLD);
+        MPI_Reduce(MPI_IN_PLACE, &(d.filter_hits_), 1, MPI_INT, MPI_SUM, 0, MPI_COMM_WORLD);
+        MPI_Reduce(MPI_IN_PLACE, &(d.bytes_on_wire_), 1, MPI_LONG_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
     }
     else{
         MPI_Reduce(&(d.spike_stats_), &(d.spike_stats_), 1, MPI_INT, MPI_SUM, 0, MPI_COMM_WORLD);
@@ -172,6 +203,8 @@ void accumulate_stats(data& d){
         MPI_Reduce(&(d.local_stats_), &(d.local_stats_), 1, MPI_INT, MPI_SUM, 0, MPI_COMM_WORLD);
         MPI_Reduce(&(d.post_spike_stats_), &(d.post_spike_stats_), 1, MPI_INT, MPI_SUM, 0, MPI_COMM_WORLD);
         MPI_Reduce(&(d.received_spike_stats_), &(d.received_spike_stats_), 1, MPI_INT, MPI_SUM, 0, MPI_COMM_WORLD);
+        MPI_Reduce(&(d.filter_hits_), &(d.filter_hits_), 1, MPI_INT, MPI_SUM, 0, MPI_COMM_WORLD);
+        MPI_Reduce(&(d.bytes_on_wire_), &(d.bytes_on_wire_), 1, MPI_LONG_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
     }
 
     if(rank == 0){
@@ -180,6 +213,9 @@ void accumulate_stats(data& d){
         std::cout<<"Total Local: "<<d.local_stats_<<std::endl;
         std::cout<<"Total Post-spike Events: "<<d.post_spike_stats_<<std::endl;
         std::cout<<"Total Received spikes: "<<d.received_spike_stats_<<std::endl;
+        if(d.received_spike_stats_ > 0)
+            std::cout<<"Filter hit rate: "<<100.*d.filter_hits_/d.received_spike_stats_<<"%"<<std::endl;
+        std::cout<<"Total bytes on wire: "<<d.bytes_on_wire_<<std::endl;
     }
 }
 
@@ -195,6 +231,8 @@ void accumulate_stats<spike::spike_interface_stats_collector>(spike::spike_inter
         MPI_Reduce(MPI_IN_PLACE, &(d.local_stats_), 1, MPI_INT, MPI_SUM, 0, MPI_COMM_WORLD);
         MPI_Reduce(MPI_IN_PLACE, &(d.post_spike_stats_), 1, MPI_INT, MPI_SUM, 0, MPI_COMM_WORLD);
         MPI_Reduce(MPI_IN_PLACE, &(d.received_spike_stats_), 1, MPI_INT, MPI_SUM, 0, MPI_COMM_WORLD);
+        MPI_Reduce(MPI_IN_PLACE, &(d.filter_hits_), 1, MPI_INT, MPI_SUM, 0, MPI_COMM_WORLD);
+        MPI_Reduce(MPI_IN_PLACE, &(d.bytes_on_wire_), 1, MPI_LONG_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
     }
     else{
         MPI_Reduce(&(d.spike_stats_), &(d.spike_stats_), 1, MPI_INT, MPI_SUM, 0, MPI_COMM_WORLD);
@@ -202,6 +240,8 @@ void accumulate_stats<spike::spike_interface_stats_collector>(spike::spike_inter
         MPI_Reduce(&(d.local_stats_), &(d.local_stats_), 1, MPI_INT, MPI_SUM, 0, MPI_COMM_WORLD);
         MPI_Reduce(&(d.post_spike_stats_), &(d.post_spike_stats_), 1, MPI_INT, MPI_SUM, 0, MPI_COMM_WORLD);
         MPI_Reduce(&(d.received_spike_stats_), &(d.received_spike_stats_), 1, MPI_INT, MPI_SUM, 0, MPI_COMM_WORLD);
+        MPI_Reduce(&(d.filter_hits_), &(d.filter_hits_), 1, MPI_INT, MPI_SUM, 0, MPI_COMM_WORLD);
+        MPI_Reduce(&(d.bytes_on_wire_), &(d.bytes_on_wire_), 1, MPI_LONG_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
     }
 
     if(rank == 0){
@@ -210,6 +250,9 @@ void accumulate_stats<spike::spike_interface_stats_collector>(spike::spike_inter
         std::cout<<"Total Local: "<<d.local_stats_<<std::endl;
         std::cout<<"Total Post-spike Events: "<<d.post_spike_stats_<<std::endl;
         std::cout<<"Total Received spikes: "<<d.received_spike_stats_<<std::endl;
+        if(d.received_spike_stats_ > 0)
+            std::cout<<"Filter hit rate: "<<100.*d.filter_hits_/d.received_spike_stats_<<"%"<<std::endl;
+        std::cout<<"Total bytes on wire: "<<d.bytes_on_wire_<<std::endl;
     }
 
     //std::cout <<"Printing Allgather times"<<std::endl;
@@ -232,6 +275,8 @@ void accumulate_stats<spike::spike_interface_stats_collector_large_mpi>(spike::s
         MPI_Reduce(MPI_IN_PLACE, &(d.local_stats_), 1, MPI_INT, MPI_SUM, 0, MPI_COMM_WORLD);
         MPI_Reduce(MPI_IN_PLACE, &(d.post_spike_stats_), 1, MPI_INT, MPI_SUM, 0, MPI_COMM_WORLD);
         MPI_Reduce(MPI_IN_PLACE, &(d.received_spike_stats_), 1, MPI_INT, MPI_SUM, 0, MPI_COMM_WORLD);
+        MPI_Reduce(MPI_IN_PLACE, &(d.filter_hits_), 1, MPI_INT, MPI_SUM, 0, MPI_COMM_WORLD);
+        MPI_Reduce(MPI_IN_PLACE, &(d.bytes_on_wire_), 1, MPI_LONG_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
     }
     else{
         MPI_Reduce(&(d.spike_stats_), &(d.spike_stats_), 1, MPI_INT, MPI_SUM, 0, MPI_COMM_WORLD);
@@ -239,6 +284,8 @@ void accumulate_stats<spike::spike_interface_stats_collector_large_mpi>(spike::s
         MPI_Reduce(&(d.local_stats_), &(d.local_stats_), 1, MPI_INT, MPI_SUM, 0, MPI_COMM_WORLD);
         MPI_Reduce(&(d.post_spike_stats_), &(d.post_spike_stats_), 1, MPI_INT, MPI_SUM, 0, MPI_COMM_WORLD);
         MPI_Reduce(&(d.received_spike_stats_), &(d.received_spike_stats_), 1, MPI_INT, MPI_SUM, 0, MPI_COMM_WORLD);
+        MPI_Reduce(&(d.filter_hits_), &(d.filter_hits_), 1, MPI_INT, MPI_SUM, 0, MPI_COMM_WORLD);
+        MPI_Reduce(&(d.bytes_on_wire_), &(d.bytes_on_wire_), 1, MPI_LONG_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
     }
 
     if(rank == 0){
@@ -247,6 +294,9 @@ void accumulate_stats<spike::spike_interface_stats_collector_large_mpi>(spike::s
         std::cout<<"Total Local: "<<d.local_stats_<<std::endl;
         std::cout<<"Total Post-spike Events: "<<d.post_spike_stats_<<std::endl;
         std::cout<<"Total Received spikes: "<<d.received_spike_stats_<<std::endl;
+        if(d.received_spike_stats_ > 0)
+            std::cout<<"Filter hit rate: "<<100.*d.filter_hits_/d.received_spike_stats_<<"%"<<std::endl;
+        std::cout<<"Total bytes on wire: "<<d.bytes_on_wire_<<std::endl;
     }
 
     if (rank == 0){
@@ -339,8 +389,29 @@ void blocking_spike(data& d, MPI_Datatype spike){
     allgather(d);
     //set the displacements
     set_displ(d);
+    d.bytes_on_wire_ += static_cast<long long>(d.spikein_.size())*wire_size(spike);
     //next distribute items to every other process using allgatherv
     allgatherv(d, spike);
 }
 
+/**
+ * \fn compact_blocking_spike(data& d, MPI_Datatype compact, double t0)
+ * \brief performs a blocking spike exchange with the compact wire format,
+ *  spikeout_ is encoded in wireout_, wirein_ is decoded in spikein_
+ * \param d the data environment on which this algo is called
+ * \param compact the MPI_Datatype of create_compact_spike_type
+ * \param t0 the start of the exchange window, the same on all the ranks
+ */
+template<typename data>
+void compact_blocking_spike(data& d, MPI_Datatype compact, double t0){
+    allgather(d);
+    set_displ(d);
+    spike::encode_spikes(d.spikeout_, t0, d.wireout_);
+    d.wirein_.resize(d.spikein_.size());
+    d.bytes_on_wire_ += static_cast<long long>(d.wirein_.size())*wire_size(compact);
+    MPI_Allgatherv(&(d.wireout_[0]), d.wireout_.size(), compact,
+        &(d.wirein_[0]), &(d.nin_[0]), &(d.displ_[0]), compact, MPI_COMM_WORLD);
+    spike::decode_spikes(d.wirein_, t0, d.spikein_);
+}
+
 #endif
@@ -0,0 +1,71 @@
+/*
+ * Neuromapp - compact.h, Copyright (c), 2015,
+ * Kai Langen - Swiss Federal Institute of technology in Lausanne,
+ * kai.langen@epfl.ch,
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.
+ */
+
+/**
+ * @file neuromapp/coreneuron_1.0/event_passing/spike/compact.h
+ * \brief Contains the compact (8 bytes) wire format of the spikes
+ */
+
+#ifndef MAPP_COMPACT_H
+#define MAPP_COMPACT_H
+
+#include <vector>
+
+#include "coreneuron_1.0/event_passing/queueing/queue.h"
+
+namespace spike {
+
+/**
+    \brief a spike on the wire: the gid and the time relative to the start of
+    the exchange window (all the ranks exchange the same interval). An event
+    is 16 bytes in memory and 12 bytes on the wire (MPI struct int + double),
+    a compact spike is 8 bytes. The float offset is exact for the integer
+    time steps of the generators and keeps ~1e-7 of a window for the others.
+ */
+struct compact_spike {
+    int gid_;
+    float dt_;
+};
+
+/** \fn encode_spikes(const std::vector<queueing::event>& in, double t0, std::vector<compact_spike>& out)
+    \brief events to compact spikes, t0 is the start of the exchange window
+ */
+inline void encode_spikes(const std::vector<queueing::event>& in, double t0, std::vector<compact_spike>& out){
+    out.resize(in.size());
+    for(int i = 0; i < in.size(); ++i){
+        out[i].gid_ = in[i].data_;
+        out[i].dt_ = static_cast<float>(in[i].t_ - t0);
+    }
+}
+
+/** \fn decode_spikes(const std::vector<compact_spike>& in, double t0, std::vector<queueing::event>& out)
+    \brief compact spikes to events, t0 must be the one of encode_spikes
+ */
+inline void decode_spikes(const std::vector<compact_spike>& in, double t0, std::vector<queueing::event>& out){
+    out.resize(in.size());
+    for(int i = 0; i < in.size(); ++i){
+        out[i].data_ = in[i].gid_;
+        out[i].t_ = t0 + in[i].dt_;
+    }
+}
+
+} //end of namespace
+
+#endif
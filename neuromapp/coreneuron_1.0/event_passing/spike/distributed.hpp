@@ -32,7 +32,9 @@
 #include <mpi.h>
 
 #include "coreneuron_1.0/event_passing/queueing/queue.h"
+#include "coreneuron_1.0/event_passing/environment/presyn_maker.h"
 #include "coreneuron_1.0/event_passing/spike/algos.hpp"
+#include "coreneuron_1.0/event_passing/spike/sparse.hpp"
 
 
 #if MPI_VERSION >= 3
@@ -136,6 +138,48 @@ MPI_Comm create_dist_graph(P& presyns, int ncells){
     return neighborhood;
 }
 
+/**
+ * \fn create_dist_graph_scalable(P& presyns, environment::neurondistribution* neuron_dist)
+ * \brief Creates the same distributed graph topology as create_dist_graph
+ * without the 2*nprocs broadcasts.
+ *
+ *Summary:
+ * - Every gid is resolved by the directory rank gid % nprocs (see
+ *   sparse_subscribe): two MPI_Alltoallv with the data of this rank only.
+ *
+ * - The owners of the gids of my input presyns are my inNeighbors.
+ *
+ * - The ranks with input presyns of my gids are my outNeighbors.
+ */
+template <typename P>
+MPI_Comm create_dist_graph_scalable(P& presyns, environment::neurondistribution* neuron_dist){
+    MPI_Comm neighborhood;
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    sparse_exchange sx(MPI_COMM_WORLD);
+    sparse_subscribe(sx, presyns, neuron_dist);
+
+    std::vector<int> inNeighbors(sx.sources_);
+    std::vector<int> outNeighbors;
+    std::map<int, std::vector<int> >::const_iterator it;
+    for(it = sx.subscribers_.begin(); it != sx.subscribers_.end(); ++it){
+        outNeighbors.insert(outNeighbors.end(), it->second.begin(), it->second.end());
+    }
+    std::sort(outNeighbors.begin(), outNeighbors.end());
+    outNeighbors.erase(std::unique(outNeighbors.begin(), outNeighbors.end()), outNeighbors.end());
+    //no self edge, the local spikes are delivered by the output presyns
+    outNeighbors.erase(std::remove(outNeighbors.begin(), outNeighbors.end(), rank), outNeighbors.end());
+    inNeighbors.erase(std::remove(inNeighbors.begin(), inNeighbors.end(), rank), inNeighbors.end());
+
+    //a rank without sources or subscribers has an empty list
+    MPI_Dist_graph_create_adjacent(MPI_COMM_WORLD, inNeighbors.size(),
+        inNeighbors.empty() ? NULL : &inNeighbors[0], (int*)MPI_UNWEIGHTED, outNeighbors.size(),
+        outNeighbors.empty() ? NULL : &outNeighbors[0], (int*)MPI_UNWEIGHTED, MPI_INFO_NULL,
+        false, &neighborhood);
+    return neighborhood;
+}
+
 template<typename data>
 void neighbor_allgather(data& d, MPI_Comm neighborhood){
     int send_size = d.spikeout_.size();
@@ -161,9 +205,26 @@ void distributed_spike(data& d, MPI_Datatype spike, MPI_Comm neighborhood){
     neighbor_allgather(d, neighborhood);
     //set the displacements
     set_displ(d);
+    d.bytes_on_wire_ += static_cast<long long>(d.spikein_.size())*wire_size(spike);
     //next distribute items to every other process using allgatherv
     neighbor_allgatherv(d, spike, neighborhood);
 }
+
+/**
+ * \fn compact_distributed_spike(data& d, MPI_Datatype compact, MPI_Comm neighborhood, double t0)
+ * \brief distributed_spike with the compact wire format (see compact_blocking_spike)
+ */
+template<typename data>
+void compact_distributed_spike(data& d, MPI_Datatype compact, MPI_Comm neighborhood, double t0){
+    neighbor_allgather(d, neighborhood);
+    set_displ(d);
+    spike::encode_spikes(d.spikeout_, t0, d.wireout_);
+    d.wirein_.resize(d.spikein_.size());
+    d.bytes_on_wire_ += static_cast<long long>(d.wirein_.size())*wire_size(compact);
+    MPI_Neighbor_allgatherv(&d.wireout_[0], d.wireout_.size(), compact,
+        &d.wirein_[0], &d.nin_[0], &d.displ_[0], compact, neighborhood);
+    spike::decode_spikes(d.wirein_, t0, d.spikein_);
+}
 #else
 /**
  * If MPI version is less than 3, there will be
@@ -175,6 +236,12 @@ MPI_Comm create_dist_graph(P& presyns, int ncells){
     exit(EXIT_FAILURE);
 }
 
+template <typename P>
+MPI_Comm create_dist_graph_scalable(P& presyns, environment::neurondistribution* neuron_dist){
+    std::cerr<<"MPI version is < 3. Cannot use distributed graph implementation"<<std::endl;
+    exit(EXIT_FAILURE);
+}
+
 template<typename data>
 void neighbor_allgather(data& d, MPI_Comm neighborhood){
     std::cerr<<"MPI version is < 3. Cannot use distributed graph implementation"<<std::endl;
@@ -193,6 +260,12 @@ void distributed_spike(data& d, MPI_Datatype spike, MPI_Comm neighborhood){
     exit(EXIT_FAILURE);
 }
 
+template<typename data>
+void compact_distributed_spike(data& d, MPI_Datatype compact, MPI_Comm neighborhood, double t0){
+    std::cerr<<"MPI version is < 3. Cannot use distributed graph implementation"<<std::endl;
+    exit(EXIT_FAILURE);
+}
+
 #endif //MPI VERSION 3
 
 #endif
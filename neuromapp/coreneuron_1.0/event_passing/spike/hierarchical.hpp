@@ -0,0 +1,262 @@
+/*
+ * Neuromapp - hierarchical.hpp, Copyright (c), 2015,
+ * Kai Langen - Swiss Federal Institute of technology in Lausanne,
+ * kai.langen@epfl.ch,
+ * All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3.0 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.
+ */
+
+/**
+ * @file neuromapp/coreneuron_1.0/event_passing/spike/hierarchical.hpp
+ * contains algorithm definitions for the node aware (two levels) spike exchange
+ */
+
+#ifndef MAPP_HIERARCHICAL_H
+#define MAPP_HIERARCHICAL_H
+
+#include <assert.h>
+#include <cstddef>
+#include <cstdlib>
+#include <algorithm>
+#include <vector>
+#include <iostream>
+#include <mpi.h>
+
+#include "coreneuron_1.0/event_passing/queueing/queue.h"
+#include "coreneuron_1.0/event_passing/spike/algos.hpp"
+
+/**
+    \brief state of the hierarchical spike exchange. The ranks of a node
+    write their spikes in a shared memory window of the node, the leader
+    (rank 0 of the node) does the allgatherv between the leaders only, into
+    a second shared window read by every rank of the node. The inter node
+    collective has one rank per node instead of every rank.
+
+    The windows belong to the leader (the other ranks allocate 0 byte),
+    they only grow. The ranks synchronize with MPI_Win_sync + MPI_Barrier
+    inside a lock_all epoch (unified memory model of MPI-3).
+ */
+struct hierarchical_exchange {
+    MPI_Comm comm_;
+    MPI_Comm node_; // the ranks sharing the windows
+    MPI_Comm leaders_; // rank 0 of every node, MPI_COMM_NULL for the others
+    int node_rank_;
+    int node_size_;
+    int nnodes_;
+    /// spikes of every rank of the node, then the total of the exchange
+    MPI_Win ctrl_win_;
+    int* ctrl_;
+    /// spikes of the node, by node rank
+    MPI_Win local_win_;
+    queueing::event* local_;
+    int local_capacity_;
+    /// spikes of all the nodes
+    MPI_Win recv_win_;
+    queueing::event* recv_;
+    int recv_capacity_;
+    /// leaders only, the allgatherv between the nodes
+    std::vector<int> node_counts_;
+    std::vector<int> node_displ_;
+
+    /** \fn hierarchical_exchange(MPI_Comm comm, int ranks_per_node)
+        \brief splits comm in shared memory nodes and creates the windows
+        (collective on comm)
+        \param ranks_per_node if > 0, a shared memory node is cut in nodes of
+        ranks_per_node ranks, to test several nodes on a single machine
+     */
+    explicit hierarchical_exchange(MPI_Comm comm, int ranks_per_node = 0);
+};
+
+#if MPI_VERSION >= 3
+/**
+ * \fn hierarchical_sync(hierarchical_exchange& hx)
+ * \brief memory barrier of the node, the writes of every rank in the
+ * windows before the call are visible to the node after the call
+ */
+inline void hierarchical_sync(hierarchical_exchange& hx){
+    MPI_Win_sync(hx.ctrl_win_);
+    MPI_Win_sync(hx.local_win_);
+    MPI_Win_sync(hx.recv_win_);
+    MPI_Barrier(hx.node_);
+    MPI_Win_sync(hx.ctrl_win_);
+    MPI_Win_sync(hx.local_win_);
+    MPI_Win_sync(hx.recv_win_);
+}
+
+/**
+ * \fn hierarchical_allocate(MPI_Comm node, int n, MPI_Win& win, T*& base)
+ * \brief allocates n elements on the leader of the node (collective on node),
+ * every rank gets the address of the leader memory in base
+ */
+template<typename T>
+void hierarchical_allocate(MPI_Comm node, int n, MPI_Win& win, T*& base){
+    int node_rank;
+    MPI_Comm_rank(node, &node_rank);
+    MPI_Aint bytes = (node_rank == 0) ? static_cast<MPI_Aint>(n)*sizeof(T) : 0;
+    void* mine;
+    MPI_Win_allocate_shared(bytes, sizeof(T), MPI_INFO_NULL, node, &mine, &win);
+    MPI_Aint size;
+    int disp_unit;
+    void* leader;
+    MPI_Win_shared_query(win, 0, &size, &disp_unit, &leader);
+    base = static_cast<T*>(leader);
+    MPI_Win_lock_all(MPI_MODE_NOCHECK, win);
+}
+
+/**
+ * \fn hierarchical_reserve(hierarchical_exchange& hx, int n, MPI_Win& win, queueing::event*& base, int& capacity)
+ * \brief grows the window to n spikes at least (collective on the node, every
+ * rank must give the same n), the content is lost
+ */
+inline void hierarchical_reserve(hierarchical_exchange& hx, int n, MPI_Win& win,
+                                 queueing::event*& base, int& capacity){
+    if(n <= capacity)
+        return;
+    capacity = std::max(n, 2*capacity);
+    MPI_Win_unlock_all(win);
+    MPI_Win_free(&win);
+    hierarchical_allocate(hx.node_, capacity, win, base);
+}
+
+inline hierarchical_exchange::hierarchical_exchange(MPI_Comm comm, int ranks_per_node):
+    comm_(comm), leaders_(MPI_COMM_NULL), local_capacity_(1), recv_capacity_(1){
+    int rank;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_split_type(comm, MPI_COMM_TYPE_SHARED, rank, MPI_INFO_NULL, &node_);
+    if(ranks_per_node > 0){
+        MPI_Comm shared = node_;
+        int shared_rank;
+        MPI_Comm_rank(shared, &shared_rank);
+        MPI_Comm_split(shared, shared_rank/ranks_per_node, rank, &node_);
+        MPI_Comm_free(&shared);
+    }
+    MPI_Comm_rank(node_, &node_rank_);
+    MPI_Comm_size(node_, &node_size_);
+    MPI_Comm_split(comm, node_rank_ == 0 ? 0 : MPI_UNDEFINED, rank, &leaders_);
+    int leader = (node_rank_ == 0);
+    MPI_Allreduce(&leader, &nnodes_, 1, MPI_INT, MPI_SUM, comm);
+    node_counts_.resize(nnodes_);
+    node_displ_.resize(nnodes_);
+
+    hierarchical_allocate(node_, node_size_ + 1, ctrl_win_, ctrl_);
+    hierarchical_allocate(node_, local_capacity_, local_win_, local_);
+    hierarchical_allocate(node_, recv_capacity_, recv_win_, recv_);
+}
+
+/**
+ * \fn free_hierarchical_exchange(hierarchical_exchange& hx)
+ * \brief frees the windows and the communicators, before MPI_Finalize
+ */
+inline void free_hierarchical_exchange(hierarchical_exchange& hx){
+    MPI_Win_unlock_all(hx.ctrl_win_);
+    MPI_Win_unlock_all(hx.local_win_);
+    MPI_Win_unlock_all(hx.recv_win_);
+    MPI_Win_free(&hx.ctrl_win_);
+    MPI_Win_free(&hx.local_win_);
+    MPI_Win_free(&hx.recv_win_);
+    if(hx.leaders_ != MPI_COMM_NULL)
+        MPI_Comm_free(&hx.leaders_);
+    MPI_Comm_free(&hx.node_);
+}
+
+/**
+ * \fn hierarchical_spike(data& d, MPI_Datatype spike, hierarchical_exchange& hx)
+ * \brief performs the spike exchange in two levels:
+ *  - every rank writes its spikes in the node window, after the spikes of
+ *    the ranks before it in the node
+ *  - the leaders gather the spike counts of the nodes (MPI_Allgather) then
+ *    the spikes of the nodes (MPI_Allgatherv) in the receive window
+ *  - every rank copies the receive window in d.spikein_
+ * The spikes come node by node, in the order of the node ranks.
+ */
+template<typename data>
+void hierarchical_spike(data& d, MPI_Datatype spike, hierarchical_exchange& hx){
+    const bool leader = (hx.node_rank_ == 0);
+
+    //the spikes of the node
+    hx.ctrl_[hx.node_rank_] = d.spikeout_.size();
+    hierarchical_sync(hx);
+    int offset = 0;
+    int node_total = 0;
+    for(int i = 0; i < hx.node_size_; ++i){
+        if(i == hx.node_rank_)
+            offset = node_total;
+        node_total += hx.ctrl_[i];
+    }
+    hierarchical_reserve(hx, node_total, hx.local_win_, hx.local_, hx.local_capacity_);
+    std::copy(d.spikeout_.begin(), d.spikeout_.end(), hx.local_ + offset);
+    hierarchical_sync(hx);
+
+    //the leaders exchange the sizes
+    if(leader){
+        MPI_Allgather(&node_total, 1, MPI_INT, &hx.node_counts_[0], 1, MPI_INT, hx.leaders_);
+        int total = 0;
+        for(int i = 0; i < hx.nnodes_; ++i){
+            hx.node_displ_[i] = total;
+            total += hx.node_counts_[i];
+        }
+        hx.ctrl_[hx.node_size_] = total;
+    }
+    hierarchical_sync(hx);
+    const int total = hx.ctrl_[hx.node_size_];
+    hierarchical_reserve(hx, total, hx.recv_win_, hx.recv_, hx.recv_capacity_);
+
+    //then the spikes, one message per node
+    if(leader){
+        MPI_Allgatherv(hx.local_, node_total, spike,
+            hx.recv_, &hx.node_counts_[0], &hx.node_displ_[0], spike, hx.leaders_);
+        d.bytes_on_wire_ += static_cast<long long>(total)*wire_size(spike);
+    }
+    hierarchical_sync(hx);
+    d.spikein_.assign(hx.recv_, hx.recv_ + total);
+}
+
+/**
+ * \fn report_hierarchical(const hierarchical_exchange& hx)
+ * \brief prints on rank 0 the number of ranks of the inter node collective
+ */
+inline void report_hierarchical(const hierarchical_exchange& hx){
+    int rank, size, max_node;
+    int node_size = hx.node_size_;
+    MPI_Comm_rank(hx.comm_, &rank);
+    MPI_Comm_size(hx.comm_, &size);
+    MPI_Reduce(&node_size, &max_node, 1, MPI_INT, MPI_MAX, 0, hx.comm_);
+    if(rank == 0){
+        std::cout<<"Hierarchical exchange: "<<hx.nnodes_<<" nodes (up to "<<max_node
+                 <<" ranks per node), inter node collective on "<<hx.nnodes_
+                 <<" ranks instead of "<<size<<std::endl;
+    }
+}
+#else
+/**
+ * If MPI version is less than 3, there is no shared memory window,
+ * so use dummy functions.
+ */
+inline hierarchical_exchange::hierarchical_exchange(MPI_Comm comm, int ranks_per_node):
+    comm_(comm), leaders_(MPI_COMM_NULL), node_rank_(0), node_size_(1), nnodes_(0),
+    ctrl_(NULL), local_(NULL), local_capacity_(0), recv_(NULL), recv_capacity_(0){}
+
+inline void free_hierarchical_exchange(hierarchical_exchange& hx){}
+
+template<typename data>
+void hierarchical_spike(data& d, MPI_Datatype spike, hierarchical_exchange& hx){
+    std::cerr<<"MPI version is < 3. Cannot use hierarchical implementation"<<std::endl;
+    exit(EXIT_FAILURE);
+}
+
+inline void report_hierarchical(const hierarchical_exchange& hx){}
+#endif //MPI VERSION 3
+
+#endif
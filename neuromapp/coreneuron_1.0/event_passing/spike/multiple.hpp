@@ -0,0 +1,161 @@
+/*
+ * Neuromapp - multiple.hpp, Copyright (c), 2015,
+ * Kai Langen - Swiss Federal Institute of technology in Lausanne,
+ * kai.langen@epfl.ch,
+ * All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3.0 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.
+ */
+
+/**
+ * @file neuromapp/coreneuron_1.0/event_passing/spike/multiple.hpp
+ * contains algorithm definitions for the per thread (MPI_THREAD_MULTIPLE)
+ * spike exchange
+ */
+
+#ifndef MAPP_MULTIPLE_H
+#define MAPP_MULTIPLE_H
+
+#include <assert.h>
+#include <cstddef>
+#include <cstdlib>
+#include <vector>
+#include <iostream>
+#include <mpi.h>
+
+#include "coreneuron_1.0/event_passing/queueing/queue.h"
+#include "coreneuron_1.0/event_passing/queueing/pool.h"
+#include "coreneuron_1.0/event_passing/spike/algos.hpp"
+
+/**
+    \brief state of the per thread spike exchange. The thread t of every rank
+    owns the communicator comms_[t] (a duplicate of comm): it gathers the
+    spikes of the cell groups it has stepped with MPI_Allgather (counts) +
+    MPI_Allgatherv as soon as they are done, inside fixed_step, while the
+    other threads still step. The threads of a rank exchange concurrently,
+    MPI must provide MPI_THREAD_MULTIPLE and every rank must have the same
+    number of threads. The union over the threads is the spikes of the
+    allgather of blocking_spike, in another order.
+ */
+struct multiple_exchange : public queueing::thread_exchange {
+    /// the received spikes of a thread, padded
+    struct thread_buffer {
+        thread_buffer():bytes_(0), time_(0.){}
+        std::vector<int> nin_;
+        std::vector<int> displ_;
+        std::vector<queueing::event> in_;
+        long long bytes_;
+        double time_; // in the MPI calls
+        char pad_[64];
+    };
+
+    MPI_Comm comm_;
+    MPI_Datatype spike_;
+    std::vector<MPI_Comm> comms_;
+    std::vector<thread_buffer> threads_;
+
+    /** \fn multiple_exchange(MPI_Comm comm, int nthreads, MPI_Datatype spike)
+        \brief one duplicate of comm per thread of the pool (collective on
+        comm), aborts if the ranks have different numbers of threads
+     */
+    multiple_exchange(MPI_Comm comm, int nthreads, MPI_Datatype spike);
+
+    /** \fn exchange(int thread, std::vector<queueing::event>& spikes)
+        \brief allgather of the spikes of the thread on its communicator,
+        called by every thread of fixed_step
+     */
+    void exchange(int thread, std::vector<queueing::event>& spikes);
+};
+
+inline multiple_exchange::multiple_exchange(MPI_Comm comm, int nthreads, MPI_Datatype spike):
+    comm_(comm), spike_(spike), comms_(nthreads), threads_(nthreads){
+    int minmax[2] = {-nthreads, nthreads};
+    MPI_Allreduce(MPI_IN_PLACE, minmax, 2, MPI_INT, MPI_MAX, comm);
+    if(-minmax[0] != minmax[1]){
+        std::cerr<<"the multiple exchange needs the same number of threads on every rank"<<std::endl;
+        MPI_Abort(comm, EXIT_FAILURE);
+    }
+    int size;
+    MPI_Comm_size(comm, &size);
+    for(int i = 0; i < nthreads; ++i){
+        MPI_Comm_dup(comm, &comms_[i]);
+        threads_[i].nin_.resize(size);
+        threads_[i].displ_.resize(size);
+    }
+}
+
+inline void multiple_exchange::exchange(int thread, std::vector<queueing::event>& spikes){
+    thread_buffer& b = threads_[thread];
+    const double t0 = MPI_Wtime();
+    int send_size = spikes.size();
+    MPI_Allgather(&send_size, 1, MPI_INT, &b.nin_[0], 1, MPI_INT, comms_[thread]);
+    int total = 0;
+    for(int i = 0; i < b.nin_.size(); ++i){
+        b.displ_[i] = total;
+        total += b.nin_[i];
+    }
+    //the spikes of the previous exchange are given to spikein_ by multiple_spike
+    const int first = b.in_.size();
+    b.in_.resize(first + total);
+    MPI_Allgatherv(spikes.empty() ? NULL : &spikes[0], send_size, spike_,
+        total > 0 ? &b.in_[first] : NULL, &b.nin_[0], &b.displ_[0], spike_, comms_[thread]);
+    b.bytes_ += static_cast<long long>(total)*wire_size(spike_);
+    b.time_ += MPI_Wtime() - t0;
+}
+
+/**
+ * \fn multiple_spike(data& d, multiple_exchange& mx)
+ * \brief after fixed_step, appends the spikes received by every thread to
+ * d.spikein_, thread by thread
+ */
+template<typename data>
+void multiple_spike(data& d, multiple_exchange& mx){
+    for(int i = 0; i < mx.threads_.size(); ++i){
+        multiple_exchange::thread_buffer& b = mx.threads_[i];
+        d.spikein_.insert(d.spikein_.end(), b.in_.begin(), b.in_.end());
+        d.bytes_on_wire_ += b.bytes_;
+        b.in_.clear();
+        b.bytes_ = 0;
+    }
+}
+
+/**
+ * \fn free_multiple_exchange(multiple_exchange& mx)
+ * \brief frees the communicators of the threads, before MPI_Finalize
+ */
+inline void free_multiple_exchange(multiple_exchange& mx){
+    for(int i = 0; i < mx.comms_.size(); ++i)
+        MPI_Comm_free(&mx.comms_[i]);
+}
+
+/**
+ * \fn report_multiple(const multiple_exchange& mx)
+ * \brief prints on rank 0 the time of every thread in the exchange, max
+ * over the ranks
+ */
+inline void report_multiple(const multiple_exchange& mx){
+    int rank;
+    MPI_Comm_rank(mx.comm_, &rank);
+    std::vector<double> times(mx.threads_.size());
+    for(int i = 0; i < times.size(); ++i)
+        times[i] = mx.threads_[i].time_;
+    MPI_Reduce(rank == 0 ? MPI_IN_PLACE : &times[0], &times[0], times.size(),
+               MPI_DOUBLE, MPI_MAX, 0, mx.comm_);
+    if(rank == 0){
+        for(int i = 0; i < times.size(); ++i)
+            std::cout<<"thread "<<i<<" exchange: "<<times[i]*1000.<<" ms (max over ranks)"<<std::endl;
+    }
+}
+
+#endif
@@ -0,0 +1,212 @@
+/*
+ * Neuromapp - network_model.h, Copyright (c), 2015,
+ * Kai Langen - Swiss Federal Institute of technology in Lausanne,
+ * kai.langen@epfl.ch,
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.
+ */
+
+/**
+ * @file neuromapp/coreneuron_1.0/event_passing/spike/network_model.h
+ * \brief Contains the alpha-beta and LogGP cost models of the spike exchange,
+ * replayed on the per step sizes of spike_interface_stats_collector_large_mpi
+ */
+
+#ifndef MAPP_NETWORK_MODEL_H
+#define MAPP_NETWORK_MODEL_H
+
+#include <cmath>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <algorithm>
+
+namespace spike {
+
+/** the exchange algorithms of the model, the counts are exchanged with the
+    same algorithm before the spikes (4 bytes per rank) */
+enum exchange_algorithm {
+    allgather_ring, // MPI_Allgatherv, P-1 steps, one block per step
+    allgather_doubling, // MPI_Allgatherv, recursive doubling, log2(P) steps
+    neighbor_allgather, // MPI_Neighbor_allgatherv on a graph of degree d
+    alltoallv_pairwise, // MPI_Alltoallv, P-1 pairwise steps, only the spikes with targets
+    nalgorithms
+};
+
+/** \fn algorithm_name(exchange_algorithm a)
+    \return the name of the algorithm in the reports
+ */
+inline const char* algorithm_name(exchange_algorithm a){
+    static const char* names[nalgorithms] = {"allgather-ring", "allgather-rd",
+                                             "neighbor-allgather", "alltoallv"};
+    return names[a];
+}
+
+/**
+    \brief point to point cost of a message of n bytes:
+     - alpha-beta (Hockney): alpha + n*beta, the messages of a rank are
+       sequential
+     - LogGP: o + (n-1)G + L + o, a rank injects a new message every
+       max(g, o + (n-1)G), so a burst of k messages overlaps their latencies
+    The times are in seconds.
+ */
+struct network_model {
+    enum kind {alpha_beta, loggp};
+
+    /** \fn network_model()
+        \brief alpha-beta model of a 10 GB/s network with a 1.5 us latency
+     */
+    network_model():kind_(alpha_beta), alpha_(1.5e-6), beta_(1e-10),
+                    L_(1e-6), o_(0.5e-6), g_(0.6e-6), G_(1e-10){}
+
+    /** \fn message(double bytes) const
+        \return the time of one message of bytes bytes
+     */
+    double message(double bytes) const {
+        if(kind_ == alpha_beta)
+            return alpha_ + bytes*beta_;
+        return 2*o_ + L_ + std::max(bytes - 1., 0.)*G_;
+    }
+
+    /** \fn burst(int n, double bytes) const
+        \return the time of n messages of bytes bytes sent back to back by one
+        rank (the receptions are symmetric)
+     */
+    double burst(int n, double bytes) const {
+        if(n <= 0)
+            return 0.;
+        if(kind_ == alpha_beta)
+            return n*message(bytes);
+        return message(bytes) + (n - 1)*std::max(g_, o_ + std::max(bytes - 1., 0.)*G_);
+    }
+
+    kind kind_;
+    double alpha_; // latency (s)
+    double beta_; // time per byte (s)
+    double L_; // latency (s)
+    double o_; // overhead of a send or a receive (s)
+    double g_; // gap between two messages (s)
+    double G_; // gap per byte (s)
+};
+
+/**
+    \brief a step of the exchange, the spikes summed over the ranks (the sum
+    file of the collector) and the spikes of the busiest rank (the max file)
+ */
+struct exchange_step {
+    explicit exchange_step(double total = 0., double max = 0.):total_(total),max_(max){}
+    double total_;
+    double max_;
+};
+
+/**
+    \brief the replay parameters: how the measured steps are extrapolated to P
+    ranks and the size of the graph of the neighbor collective
+ */
+struct exchange_scaling {
+    exchange_scaling():nprocs_(1), weak_(true), fanout_(12), degree_(16), bytes_(12){}
+    int nprocs_; // the ranks of the measured run
+    bool weak_; // weak: the spikes per rank are kept, strong: the total is kept
+    int fanout_; // targets of a cell, a rank gets a spike with 1-(1-1/P)^fanout
+    int degree_; // neighbors of a rank in the neighbor collective
+    int bytes_; // bytes of a spike on the wire, 12 (event) or 8 (compact)
+};
+
+/** \fn exchange_time(const network_model& net, exchange_algorithm a, int nprocs, double mean, double max, const exchange_scaling& s)
+    \brief predicted time of one exchange on nprocs ranks (counts + spikes)
+    \param mean the spikes of a rank, on average
+    \param max the spikes of the busiest rank, the ring and the pairwise
+    steps wait for it
+ */
+inline double exchange_time(const network_model& net, exchange_algorithm a, int nprocs,
+                            double mean, double max, const exchange_scaling& s){
+    if(nprocs <= 1)
+        return 0.;
+    double t = 0.;
+    switch(a){
+        case allgather_ring:
+            t = (nprocs - 1)*(net.message(4.) + net.message(max*s.bytes_));
+            break;
+        case allgather_doubling:
+            //the last step of a non power of 2 only sends the remaining blocks
+            for(int blocks = 1; blocks < nprocs; blocks *= 2){
+                int n = std::min(blocks, nprocs - blocks);
+                t += net.message(4.*n) + net.message(n*mean*s.bytes_);
+            }
+            break;
+        case neighbor_allgather:{
+            int d = std::min(s.degree_, nprocs - 1);
+            t = net.burst(d, 4.) + net.burst(d, max*s.bytes_);
+            break;
+        }
+        case alltoallv_pairwise:{
+            double q = 1. - std::pow(1. - 1./nprocs, s.fanout_);
+            t = (nprocs - 1)*(net.message(4.) + net.message(max*q*s.bytes_));
+            break;
+        }
+        default:
+            break;
+    }
+    return t;
+}
+
+/** \fn replay(const network_model& net, exchange_algorithm a, const std::vector<exchange_step>& steps, int nprocs, const exchange_scaling& s)
+    \brief predicted time of every step of the measured run on nprocs ranks
+ */
+inline std::vector<double> replay(const network_model& net, exchange_algorithm a,
+                                  const std::vector<exchange_step>& steps, int nprocs,
+                                  const exchange_scaling& s){
+    std::vector<double> times(steps.size());
+    const double ratio = static_cast<double>(nprocs)/s.nprocs_;
+    for(int i = 0; i < steps.size(); ++i){
+        double mean = steps[i].total_/s.nprocs_;
+        double max = std::max(steps[i].max_, mean);
+        if(!s.weak_){
+            mean /= ratio;
+            max /= ratio;
+        }
+        times[i] = exchange_time(net, a, nprocs, mean, max, s);
+    }
+    return times;
+}
+
+/** \fn read_steps(const std::string& sum, const std::string& max, std::vector<exchange_step>& steps)
+    \brief reads the allgather_v_sizes files of the collector, one value per
+    step, the max file is optional (empty name), the busiest rank is the
+    mean rank if so
+    \return false if a file cannot be read or the files have different sizes
+ */
+inline bool read_steps(const std::string& sum, const std::string& max, std::vector<exchange_step>& steps){
+    std::ifstream in(sum.c_str());
+    if(!in)
+        return false;
+    steps.clear();
+    double v;
+    while(in >> v)
+        steps.push_back(exchange_step(v, 0.));
+    if(max.empty())
+        return true;
+    std::ifstream in_max(max.c_str());
+    if(!in_max)
+        return false;
+    int i = 0;
+    for(; i < steps.size() && in_max >> v; ++i)
+        steps[i].max_ = v;
+    return i == steps.size() && !(in_max >> v);
+}
+
+} //end of namespace
+
+#endif
@@ -0,0 +1,195 @@
+/*
+ * Neuromapp - nonblocking.hpp, Copyright (c), 2015,
+ * Kai Langen - Swiss Federal Institute of technology in Lausanne,
+ * kai.langen@epfl.ch,
+ * All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3.0 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.
+ */
+
+/**
+ * @file neuromapp/coreneuron_1.0/event_passing/spike/nonblocking.hpp
+ * contains algorithm definitions for the overlapped (non-blocking) spike exchange
+ */
+
+#ifndef MAPP_NONBLOCKING_H
+#define MAPP_NONBLOCKING_H
+
+#include <assert.h>
+#include <cstddef>
+#include <vector>
+#include <iostream>
+#include <mpi.h>
+
+#include "coreneuron_1.0/event_passing/queueing/queue.h"
+#include "coreneuron_1.0/event_passing/spike/algos.hpp"
+#include "coreneuron_1.0/event_passing/spike/compact.h"
+
+/**
+    \brief state of the overlapped spike exchange. The spikes of the interval k
+    travel while the pool integrates the interval k+1, they are filtered
+    (enqueued) one interval later, the drivers step intervals of min_delay/2
+    so that the spikes are still filtered within min_delay. Double buffers: sendbuf_ is owned by the
+    Iallgatherv in flight while the pool fills spikeout_ again, recvbuf_ is
+    received while the pool filters spikein_. With compact_, the wire buffers
+    hold the encoded spikes of the same exchange.
+ */
+struct nonblocking_exchange {
+    MPI_Comm comm_;
+    bool neighbor_; // neighbor collectives of a distributed graph
+    bool compact_; // compact wire format (compact.h), the datatype is the compact one
+    bool in_flight_;
+    double t0_; // exchange window of the spikes in flight
+    int send_count_;
+    std::vector<int> nin_;
+    std::vector<int> displ_;
+    std::vector<queueing::event> sendbuf_;
+    std::vector<queueing::event> recvbuf_;
+    std::vector<spike::compact_spike> wiresend_;
+    std::vector<spike::compact_spike> wirerecv_;
+    MPI_Request count_request_;
+    MPI_Request data_request_;
+
+    //STATS
+    double exposed_time_; // time spent in the MPI calls (post + wait)
+    double in_flight_time_; // from the post of the Iallgatherv to its completion
+    double post_time_;
+    int exchanges_;
+
+    /** \fn nonblocking_exchange(MPI_Comm comm, bool neighbor)
+        \brief comm is MPI_COMM_WORLD or the distributed graph, if neighbor
+        \param nin number of ranks (neighbors) the spikes come from
+     */
+    explicit nonblocking_exchange(MPI_Comm comm, int nin, bool neighbor = false):
+        comm_(comm), neighbor_(neighbor), compact_(false), in_flight_(false), t0_(0.), send_count_(0),
+        nin_(nin), displ_(nin), exposed_time_(0.), in_flight_time_(0.),
+        post_time_(0.), exchanges_(0) {}
+};
+
+#if MPI_VERSION >= 3
+/**
+ * \fn nonblocking_spike_wait(data& d, nonblocking_exchange& nb)
+ * \brief wait the exchange in flight, the received spikes go in d.spikein_
+ * \param d the data environment on which this algo is called
+ */
+template<typename data>
+void nonblocking_spike_wait(data& d, nonblocking_exchange& nb){
+    if(!nb.in_flight_)
+        return;
+    double t0 = MPI_Wtime();
+    MPI_Wait(&nb.data_request_, MPI_STATUS_IGNORE);
+    double t1 = MPI_Wtime();
+    nb.exposed_time_ += t1 - t0;
+    nb.in_flight_time_ += t1 - nb.post_time_;
+    nb.in_flight_ = false;
+    if(nb.compact_)
+        spike::decode_spikes(nb.wirerecv_, nb.t0_, nb.recvbuf_);
+    d.spikein_.swap(nb.recvbuf_);
+}
+
+/**
+ * \fn nonblocking_spike(data& d, MPI_Datatype spike, nonblocking_exchange& nb)
+ * \brief start the exchange of d.spikeout_ and complete the previous one:
+ *  - Iallgather of the number of spikes of this interval
+ *  - wait the spikes of the previous interval, they go in d.spikein_
+ *  - Iallgatherv of the spikes of this interval, it overlaps the next fixed_step
+ *  The count is posted first to overlap the wait of the previous interval.
+ * \param d the data environment on which this algo is called
+ * \param spike the MPI_Datatype being communicated
+ * \param t0 the start of the exchange window, for the compact format
+ */
+template<typename data>
+void nonblocking_spike(data& d, MPI_Datatype spike, nonblocking_exchange& nb, double t0 = 0.){
+    double start = MPI_Wtime();
+    nb.send_count_ = d.spikeout_.size();
+    if(nb.neighbor_)
+        MPI_Ineighbor_allgather(&nb.send_count_, 1, MPI_INT, &nb.nin_[0], 1, MPI_INT,
+                                nb.comm_, &nb.count_request_);
+    else
+        MPI_Iallgather(&nb.send_count_, 1, MPI_INT, &nb.nin_[0], 1, MPI_INT,
+                       nb.comm_, &nb.count_request_);
+    nb.exposed_time_ += MPI_Wtime() - start;
+
+    nonblocking_spike_wait(d, nb);
+
+    // the previous Iallgatherv is done, its buffer can take this interval
+    nb.sendbuf_.swap(d.spikeout_);
+
+    start = MPI_Wtime();
+    MPI_Wait(&nb.count_request_, MPI_STATUS_IGNORE);
+    int total = 0;
+    for(int i = 0; i < nb.nin_.size(); ++i){
+        nb.displ_[i] = total;
+        total += nb.nin_[i];
+    }
+    nb.recvbuf_.resize(total);
+    void* sendbuf = &nb.sendbuf_[0];
+    void* recvbuf = &nb.recvbuf_[0];
+    if(nb.compact_){
+        nb.t0_ = t0;
+        spike::encode_spikes(nb.sendbuf_, t0, nb.wiresend_);
+        nb.wirerecv_.resize(total);
+        sendbuf = &nb.wiresend_[0];
+        recvbuf = &nb.wirerecv_[0];
+    }
+    d.bytes_on_wire_ += static_cast<long long>(total)*wire_size(spike);
+    if(nb.neighbor_)
+        MPI_Ineighbor_allgatherv(sendbuf, nb.send_count_, spike, recvbuf,
+                                 &nb.nin_[0], &nb.displ_[0], spike, nb.comm_, &nb.data_request_);
+    else
+        MPI_Iallgatherv(sendbuf, nb.send_count_, spike, recvbuf,
+                        &nb.nin_[0], &nb.displ_[0], spike, nb.comm_, &nb.data_request_);
+    nb.post_time_ = MPI_Wtime();
+    nb.exposed_time_ += nb.post_time_ - start;
+    nb.in_flight_ = true;
+    ++nb.exchanges_;
+}
+
+#else
+template<typename data>
+void nonblocking_spike_wait(data& d, nonblocking_exchange& nb){
+    std::cerr<<"MPI version is < 3. Cannot use non-blocking collectives"<<std::endl;
+    exit(EXIT_FAILURE);
+}
+
+template<typename data>
+void nonblocking_spike(data& d, MPI_Datatype spike, nonblocking_exchange& nb, double t0 = 0.){
+    std::cerr<<"MPI version is < 3. Cannot use non-blocking collectives"<<std::endl;
+    exit(EXIT_FAILURE);
+}
+#endif //MPI VERSION 3
+
+/**
+ * \fn report_exchange(const nonblocking_exchange& nb)
+ * \brief print (rank 0) the max over the ranks of the exposed time and of the
+ *  time in flight, the rest of the in flight time was hidden by fixed_step.
+ *  A blocking exchange only adds to both times, nothing is hidden.
+ */
+inline void report_exchange(const nonblocking_exchange& nb){
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    double times[2] = {nb.exposed_time_, nb.in_flight_time_};
+    double max_times[2];
+    MPI_Reduce(times, max_times, 2, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+    if(rank == 0){
+        double hidden = (max_times[1] > 0.) ? 1. - max_times[0]/max_times[1] : 0.;
+        if(hidden < 0.)
+            hidden = 0.;
+        std::cout<<"Exchange exposed time: "<<max_times[0]*1000.<<" ms"<<std::endl;
+        std::cout<<"Exchange in flight time: "<<max_times[1]*1000.<<" ms"<<std::endl;
+        std::cout<<"Exchange hidden: "<<hidden*100.<<" %"<<std::endl;
+    }
+}
+
+#endif
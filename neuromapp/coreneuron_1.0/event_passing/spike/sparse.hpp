@@ -0,0 +1,278 @@
+/*
+ * Neuromapp - sparse.hpp, Copyright (c), 2015,
+ * Kai Langen - Swiss Federal Institute of technology in Lausanne,
+ * kai.langen@epfl.ch,
+ * All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3.0 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.
+ */
+
+/**
+ * @file neuromapp/coreneuron_1.0/event_passing/spike/sparse.hpp
+ * contains algorithm definitions for the sparse (point to point) spike exchange
+ */
+
+#ifndef MAPP_SPARSE_H
+#define MAPP_SPARSE_H
+
+#include <assert.h>
+#include <cstddef>
+#include <algorithm>
+#include <map>
+#include <vector>
+#include <iostream>
+#include <mpi.h>
+
+#include "coreneuron_1.0/event_passing/queueing/queue.h"
+#include "coreneuron_1.0/event_passing/environment/neurondistribution.h"
+#include "coreneuron_1.0/event_passing/spike/algos.hpp"
+#include "coreneuron_1.0/event_passing/spike/compact.h"
+
+/**
+    \brief state of the sparse spike exchange. Every rank knows the ranks
+    holding targets of its gids (subscribers_), a spike is only sent to them
+    with MPI_Alltoallv instead of being gathered by every rank. The volume
+    follows the connectivity, not the number of ranks.
+ */
+struct sparse_exchange {
+    MPI_Comm comm_;
+    bool compact_; // compact wire format (compact.h), the datatype is the compact one
+    /// for each local gid with remote targets, the ranks holding the targets
+    std::map<int, std::vector<int> > subscribers_;
+    /// the ranks owning the gids of my input presyns, increasing order
+    std::vector<int> sources_;
+    std::vector<int> sendcounts_;
+    std::vector<int> sdispl_;
+    std::vector<int> recvcounts_;
+    std::vector<int> rdispl_;
+    std::vector<int> fill_; // next free slot of every destination in sendbuf_
+    std::vector<queueing::event> sendbuf_; // spikes sorted by destination
+    std::vector<spike::compact_spike> wiresend_;
+
+    //STATS
+    long long spikes_out_; // spikes of this rank, an allgather sends them to every rank
+    long long sent_; // copies of the spikes sent to the subscribers
+    double setup_time_;
+
+    /** \fn sparse_exchange(MPI_Comm comm)
+        \brief the buffers are sized with the number of ranks of comm,
+        sparse_subscribe must be called before the first exchange
+     */
+    explicit sparse_exchange(MPI_Comm comm):
+        comm_(comm), compact_(false), spikes_out_(0), sent_(0), setup_time_(0.) {
+        int size;
+        MPI_Comm_size(comm, &size);
+        sendcounts_.resize(size);
+        sdispl_.resize(size);
+        recvcounts_.resize(size);
+        rdispl_.resize(size);
+        fill_.resize(size);
+    }
+};
+
+/**
+ * \fn sparse_alltoallv_int(const std::vector<std::vector<int> >& out, MPI_Comm comm, std::vector<int>& in, std::vector<int>& from)
+ * \brief personalized exchange of int used by the setup, out[r] is sent to the
+ * rank r
+ * \param in receives everything, by increasing source rank
+ * \param from the source rank of every element of in
+ */
+inline void sparse_alltoallv_int(const std::vector<std::vector<int> >& out, MPI_Comm comm,
+                                 std::vector<int>& in, std::vector<int>& from){
+    const int size = out.size();
+    std::vector<int> sendcounts(size), sdispl(size), recvcounts(size), rdispl(size);
+    std::vector<int> sendbuf;
+    for(int r = 0; r < size; ++r){
+        sendcounts[r] = out[r].size();
+        sdispl[r] = sendbuf.size();
+        sendbuf.insert(sendbuf.end(), out[r].begin(), out[r].end());
+    }
+    MPI_Alltoall(&sendcounts[0], 1, MPI_INT, &recvcounts[0], 1, MPI_INT, comm);
+    int total = 0;
+    for(int r = 0; r < size; ++r){
+        rdispl[r] = total;
+        total += recvcounts[r];
+    }
+    from.resize(total);
+    for(int r = 0; r < size; ++r)
+        std::fill(from.begin() + rdispl[r], from.begin() + rdispl[r] + recvcounts[r], r);
+    //&v[0] must be valid even if nothing is sent or received
+    sendbuf.resize(std::max<std::size_t>(sendbuf.size(), 1));
+    in.resize(std::max(total, 1));
+    MPI_Alltoallv(&sendbuf[0], &sendcounts[0], &sdispl[0], MPI_INT,
+                  &in[0], &recvcounts[0], &rdispl[0], MPI_INT, comm);
+    in.resize(total);
+}
+
+/**
+ * \fn sparse_subscribe(sparse_exchange& sx, const P& presyns, environment::neurondistribution* neuron_dist)
+ * \brief fills sx.subscribers_ and sx.sources_ from the input presyns of every
+ * rank. No rank knows the owner of a gid, so the gid g is resolved by the
+ * directory rank g % size:
+ *  - the ranks send (input, gid) for the gids of their input presyns and
+ *    (owned, gid) for their own gids to the directory
+ *  - the directory sends (subscriber, gid, rank of the input presyn) to the
+ *    owner and (source, gid, owner) to the rank of the input presyn
+ * Two personalized exchanges with the data of this rank only, no global table.
+ */
+template <typename P>
+void sparse_subscribe(sparse_exchange& sx, const P& presyns, environment::neurondistribution* neuron_dist){
+    enum {input, owned, subscriber, source};
+    double start = MPI_Wtime();
+    const int size = sx.sendcounts_.size();
+    std::vector<std::vector<int> > out(size);
+    std::vector<int> gids;
+
+    //the gids I need and the gids I own, to their directory
+    presyns.input_gids(gids);
+    for(std::size_t i = 0; i < gids.size(); ++i){
+        out[gids[i] % size].push_back(input);
+        out[gids[i] % size].push_back(gids[i]);
+    }
+    for(std::size_t i = 0; i < neuron_dist->getlocalcells(); ++i){
+        const int gid = neuron_dist->local2global(i);
+        out[gid % size].push_back(owned);
+        out[gid % size].push_back(gid);
+    }
+    std::vector<int> in, from;
+    sparse_alltoallv_int(out, sx.comm_, in, from);
+
+    //directory: match the inputs with the owners, my gids are rank + k*size
+    std::vector<int> owner_of(neuron_dist->getglobalcells()/size + 1, -1);
+    for(std::size_t i = 0; i < in.size(); i += 2){
+        if(in[i] == owned)
+            owner_of[in[i+1]/size] = from[i];
+    }
+    for(int r = 0; r < size; ++r)
+        out[r].clear();
+    for(std::size_t i = 0; i < in.size(); i += 2){
+        if(in[i] != input)
+            continue;
+        const int owner = owner_of[in[i+1]/size];
+        assert(owner >= 0);
+        const int triple_owner[3] = {subscriber, in[i+1], from[i]};
+        const int triple_input[3] = {source, in[i+1], owner};
+        out[owner].insert(out[owner].end(), triple_owner, triple_owner + 3);
+        out[from[i]].insert(out[from[i]].end(), triple_input, triple_input + 3);
+    }
+    sparse_alltoallv_int(out, sx.comm_, in, from);
+
+    sx.subscribers_.clear();
+    sx.sources_.clear();
+    for(std::size_t i = 0; i < in.size(); i += 3){
+        if(in[i] == subscriber)
+            sx.subscribers_[in[i+1]].push_back(in[i+2]);
+        else
+            sx.sources_.push_back(in[i+2]);
+    }
+    std::sort(sx.sources_.begin(), sx.sources_.end());
+    sx.sources_.erase(std::unique(sx.sources_.begin(), sx.sources_.end()), sx.sources_.end());
+    sx.setup_time_ = MPI_Wtime() - start;
+}
+
+/**
+ * \fn sparse_spike(data& d, MPI_Datatype spike, sparse_exchange& sx, double t0)
+ * \brief the spikes of d.spikeout_ are only sent to the subscribers of their
+ * gid: MPI_Alltoall of the counts then MPI_Alltoallv of the spikes. Every
+ * spike received in d.spikein_ has at least one target on this rank.
+ * \param spike the MPI_Datatype, the compact one if sx.compact_
+ * \param t0 start of the exchange window, for the compact wire format
+ */
+template<typename data>
+void sparse_spike(data& d, MPI_Datatype spike, sparse_exchange& sx, double t0 = 0.){
+    const int size = sx.sendcounts_.size();
+    std::map<int, std::vector<int> >::const_iterator it;
+
+    //count the copies for every destination
+    std::fill(sx.sendcounts_.begin(), sx.sendcounts_.end(), 0);
+    for(std::size_t i = 0; i < d.spikeout_.size(); ++i){
+        if((it = sx.subscribers_.find(d.spikeout_[i].data_)) != sx.subscribers_.end()){
+            for(std::size_t j = 0; j < it->second.size(); ++j)
+                ++sx.sendcounts_[it->second[j]];
+        }
+    }
+    int total = 0;
+    for(int r = 0; r < size; ++r){
+        sx.sdispl_[r] = total;
+        total += sx.sendcounts_[r];
+    }
+
+    //sort the copies by destination
+    sx.sendbuf_.resize(std::max(total, 1));
+    std::copy(sx.sdispl_.begin(), sx.sdispl_.end(), sx.fill_.begin());
+    for(std::size_t i = 0; i < d.spikeout_.size(); ++i){
+        if((it = sx.subscribers_.find(d.spikeout_[i].data_)) != sx.subscribers_.end()){
+            for(std::size_t j = 0; j < it->second.size(); ++j)
+                sx.sendbuf_[sx.fill_[it->second[j]]++] = d.spikeout_[i];
+        }
+    }
+
+    MPI_Alltoall(&sx.sendcounts_[0], 1, MPI_INT, &sx.recvcounts_[0], 1, MPI_INT, sx.comm_);
+    int nrecv = 0;
+    for(int r = 0; r < size; ++r){
+        sx.rdispl_[r] = nrecv;
+        nrecv += sx.recvcounts_[r];
+    }
+
+    if(sx.compact_){
+        sx.sendbuf_.resize(total);
+        spike::encode_spikes(sx.sendbuf_, t0, sx.wiresend_);
+        sx.wiresend_.resize(std::max(total, 1));
+        d.wirein_.resize(std::max(nrecv, 1));
+        MPI_Alltoallv(&sx.wiresend_[0], &sx.sendcounts_[0], &sx.sdispl_[0], spike,
+                      &d.wirein_[0], &sx.recvcounts_[0], &sx.rdispl_[0], spike, sx.comm_);
+        d.wirein_.resize(nrecv);
+        spike::decode_spikes(d.wirein_, t0, d.spikein_);
+    }
+    else{
+        d.spikein_.resize(std::max(nrecv, 1));
+        MPI_Alltoallv(&sx.sendbuf_[0], &sx.sendcounts_[0], &sx.sdispl_[0], spike,
+                      &d.spikein_[0], &sx.recvcounts_[0], &sx.rdispl_[0], spike, sx.comm_);
+        d.spikein_.resize(nrecv);
+    }
+
+    sx.spikes_out_ += d.spikeout_.size();
+    sx.sent_ += total;
+    d.bytes_on_wire_ += static_cast<long long>(nrecv)*wire_size(spike);
+}
+
+/**
+ * \fn report_sparse(sparse_exchange& sx, MPI_Datatype spike)
+ * \brief prints on rank 0 the spikes sent by the sparse exchange, the spikes
+ * an allgather would have sent (every spike to every rank) and the bytes saved
+ */
+inline void report_sparse(const sparse_exchange& sx, MPI_Datatype spike){
+    int rank, size;
+    MPI_Comm_rank(sx.comm_, &rank);
+    MPI_Comm_size(sx.comm_, &size);
+    long long local[2] = {sx.spikes_out_, sx.sent_};
+    long long global[2] = {0, 0};
+    double setup_time = sx.setup_time_;
+    double setup = 0.;
+    MPI_Reduce(local, global, 2, MPI_LONG_LONG, MPI_SUM, 0, sx.comm_);
+    MPI_Reduce(&setup_time, &setup, 1, MPI_DOUBLE, MPI_MAX, 0, sx.comm_);
+    if(rank == 0){
+        const long long gathered = global[0]*size;
+        const long long saved = (gathered - global[1])*wire_size(spike);
+        std::cout<<"Sparse exchange setup time: "<<setup<<" s"<<std::endl;
+        std::cout<<"Sparse exchange spikes sent: "<<global[1]
+                 <<", allgather: "<<gathered<<std::endl;
+        std::cout<<"Sparse exchange bytes saved: "<<saved;
+        if(gathered > 0)
+            std::cout<<" ("<<100.*(gathered - global[1])/gathered<<"%)";
+        std::cout<<std::endl;
+    }
+}
+
+#endif
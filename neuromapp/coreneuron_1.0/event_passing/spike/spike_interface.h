@@ -31,6 +31,7 @@
 #include <fstream>
 
 #include "utils/omp/lock.h"
+#include "coreneuron_1.0/event_passing/spike/compact.h"
 
 namespace spike {
 
@@ -47,6 +48,9 @@ struct spike_interface{
     std::vector<queueing::event> spikeout_;
     std::vector<int> nin_;
     std::vector<int> displ_;
+    //compact wire format, see compact.h
+    std::vector<compact_spike> wireout_;
+    std::vector<compact_spike> wirein_;
 
     //STATS ACCUMULATORS
     int spike_stats_;
@@ -54,6 +58,8 @@ struct spike_interface{
     int local_stats_;
     int post_spike_stats_;
     int received_spike_stats_;
+    int filter_hits_; // received spikes with an input presyn on this rank
+    long long bytes_on_wire_; // bytes of spikes received by this rank
 
     /** \fn spike_interface(int nprocs)
         \brief spike_interface constructor. Initializes nin and displ buffers
@@ -64,7 +70,9 @@ struct spike_interface{
         ite_stats_(0),
         local_stats_(0),
         post_spike_stats_(0),
-        received_spike_stats_(0)
+        received_spike_stats_(0),
+        filter_hits_(0),
+        bytes_on_wire_(0)
         {nin_.resize(nprocs); displ_.resize(nprocs);}
 };
 
@@ -0,0 +1,351 @@
+/*
+ Copyright (c) 2016, Blue Brain Project
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without modification,
+ are permitted provided that the following conditions are met:
+ 1. Redistributions of source code must retain the above copyright notice,
+ this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright notice,
+ this list of conditions and the following disclaimer in the documentation
+ and/or other materials provided with the distribution.
+ 3. Neither the name of the copyright holder nor the names of its contributors
+ may be used to endorse or promote products derived from this software
+ without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef concurrent_benchmark_h
+#define concurrent_benchmark_h
+
+#include <vector>
+#include <queue>
+#include <iterator>
+#include <algorithm>
+#include <functional>
+
+#include <boost/random/mersenne_twister.hpp>
+#include <boost/random/uniform_real_distribution.hpp>
+#include <boost/random/uniform_int_distribution.hpp>
+
+#include "utils/omp/lock.h"
+#include "utils/omp/compatibility.h"
+#include "coreneuron_1.0/queue/timer_asm.h"
+
+namespace queue{
+
+/** Concurrent benchmark, it mimics the inter thread delivery of the event_passing miniapp:
+    every time step the P producers (OpenMP threads) push events into the queue of a target,
+    then, after a barrier, every target drains its events <= t. Two layouts:
+
+    - one_target: P producers, 1 consumer (the thread 0)
+    - all_targets: P producers, P consumers, the target of an event is random (P x P)
+
+    Three strategies are compared for the queue of a target, all with the same API:
+    push(producer,t), flush(producer) at the end of the push phase of a producer and
+    drain_until(t,out) by the consumer.
+ */
+
+    enum concurrent_mode {one_target, all_targets};
+
+    typedef std::priority_queue<double, std::vector<double>, std::greater<double> > min_heap;
+
+    /** a single heap, every push takes the lock */
+    class mutex_heap{
+    public:
+        mutex_heap(){}
+
+        inline void push(int producer, double t){
+            lock_.lock();
+            heap_.push(t);
+            lock_.unlock();
+        }
+
+        inline void flush(int producer){}
+
+        template<class OutputIt>
+        OutputIt drain_until(double t, OutputIt out){
+            lock_.lock();
+            while(!heap_.empty() && heap_.top() <= t){
+                *out++ = heap_.top();
+                heap_.pop();
+            }
+            lock_.unlock();
+            return out;
+        }
+
+        static const char* name(){
+            return "mutex_heap";
+        }
+
+    private:
+        mapp::mutex lock_;
+        min_heap heap_;
+    };
+
+    /** relaxed MultiQueue (Rihani, Sanders and Dementiev, SPAA 2015): c*P heaps with their
+        own lock, a push goes in a random free heap, a pop takes the smallest top of two
+        random heaps. The events are delivered out of order, the order is only exact
+        when a drain finishes (no event <= t left) */
+    class multi_queue{
+        struct sub{
+            mapp::mutex lock_;
+            min_heap heap_;
+            char pad_[64]; // no false sharing between the locks
+        };
+
+    public:
+        explicit multi_queue(int producers, int c = 2):subs_(c*producers),seeds_(16*(producers+1),1){
+            for(std::size_t i = 0; i < subs_.size(); ++i)
+                subs_[i] = new sub;
+            for(int i = 0; i <= producers; ++i)
+                seeds_[16*i] = 2463534242u + 7919u*i;
+        }
+
+        ~multi_queue(){
+            for(std::size_t i = 0; i < subs_.size(); ++i)
+                delete subs_[i];
+        }
+
+        inline void push(int producer, double t){
+            for(;;){
+                sub& s = *subs_[random(producer) % subs_.size()];
+                if(s.lock_.try_lock()){
+                    s.heap_.push(t);
+                    s.lock_.unlock();
+                    return;
+                }
+            }
+        }
+
+        inline void flush(int producer){}
+
+        /** the consumer uses the last seed, two random choices then a full scan when both
+            heaps have nothing to deliver */
+        template<class OutputIt>
+        OutputIt drain_until(double t, OutputIt out){
+            const int consumer = static_cast<int>(seeds_.size()/16) - 1;
+            for(;;){
+                std::size_t i = random(consumer) % subs_.size();
+                std::size_t j = random(consumer) % subs_.size();
+                if(!ready(i,t) || (ready(j,t) && top(j) < top(i)))
+                    i = j;
+                if(!ready(i,t)){
+                    i = subs_.size();
+                    for(std::size_t k = 0; k < subs_.size() && i == subs_.size(); ++k)
+                        if(ready(k,t))
+                            i = k;
+                    if(i == subs_.size())
+                        break; // nothing <= t
+                }
+                sub& s = *subs_[i];
+                s.lock_.lock();
+                *out++ = s.heap_.top();
+                s.heap_.pop();
+                s.lock_.unlock();
+            }
+            return out;
+        }
+
+        static const char* name(){
+            return "multi_queue";
+        }
+
+    private:
+        inline bool ready(std::size_t i, double t) const {
+            return !subs_[i]->heap_.empty() && subs_[i]->heap_.top() <= t;
+        }
+
+        inline double top(std::size_t i) const {
+            return subs_[i]->heap_.top();
+        }
+
+        /** xorshift32, one state per thread on its own cache line */
+        inline unsigned int random(int id){
+            unsigned int& x = seeds_[16*id];
+            x ^= x << 13;
+            x ^= x >> 17;
+            x ^= x << 5;
+            return x;
+        }
+
+        std::vector<sub*> subs_;
+        std::vector<unsigned int> seeds_;
+    };
+
+    /** no lock: a producer appends in its own buffer and sorts it at the end of its push
+        phase (in parallel with the other producers), the consumer keeps the sorted runs
+        and merges them with a heap of the run heads */
+    class sorted_runs{
+        struct buffer{
+            std::vector<double> v_;
+            char pad_[64]; // no false sharing between the producers
+        };
+
+        struct run{
+            std::vector<double> v_;
+            std::size_t cur_;
+        };
+
+        typedef std::pair<double, std::size_t> head; // time, run
+        typedef std::priority_queue<head, std::vector<head>, std::greater<head> > head_heap;
+
+    public:
+        explicit sorted_runs(int producers):buffers_(producers){}
+
+        inline void push(int producer, double t){
+            buffers_[producer].v_.push_back(t);
+        }
+
+        inline void flush(int producer){
+            std::vector<double>& v = buffers_[producer].v_;
+            std::sort(v.begin(), v.end());
+        }
+
+        template<class OutputIt>
+        OutputIt drain_until(double t, OutputIt out){
+            // the buffers of the producers become runs
+            for(std::size_t i = 0; i < buffers_.size(); ++i){
+                if(buffers_[i].v_.empty())
+                    continue;
+                std::size_t r = runs_.size();
+                if(!free_.empty()){
+                    r = free_.back();
+                    free_.pop_back();
+                }else{
+                    runs_.push_back(run());
+                }
+                runs_[r].v_.swap(buffers_[i].v_); // the buffer gets the capacity of an old run
+                runs_[r].cur_ = 0;
+                heads_.push(head(runs_[r].v_[0], r));
+            }
+
+            while(!heads_.empty() && heads_.top().first <= t){
+                const std::size_t r = heads_.top().second;
+                heads_.pop();
+                run& k = runs_[r];
+                *out++ = k.v_[k.cur_++];
+                // the next element of the run, the run stays while it goes below t
+                while(k.cur_ < k.v_.size() && k.v_[k.cur_] <= t && (heads_.empty() || k.v_[k.cur_] <= heads_.top().first))
+                    *out++ = k.v_[k.cur_++];
+                if(k.cur_ < k.v_.size()){
+                    heads_.push(head(k.v_[k.cur_], r));
+                }else{
+                    k.v_.clear();
+                    free_.push_back(r);
+                }
+            }
+            return out;
+        }
+
+        static const char* name(){
+            return "sorted_runs";
+        }
+
+    private:
+        std::vector<buffer> buffers_;
+        std::vector<run> runs_;
+        std::vector<std::size_t> free_; // empty runs
+        head_heap heads_;
+    };
+
+    /** cycles measured by the thread 0 between the barriers */
+    struct concurrent_result{
+        concurrent_result():push(0),drain(0),events(0),delivered(0),inversions(0){}
+        unsigned long long int push; // push phase, producers
+        unsigned long long int drain; // drain phase, consumers
+        unsigned long long int events;
+        unsigned long long int delivered;
+        unsigned long long int inversions; // delivered before a smaller time, same drain
+    };
+
+    /** a queue of a target for producers threads, the strategies with a per
+        producer state take their number */
+    template<class Q>
+    inline Q* make_target(int producers){
+        return new Q(producers);
+    }
+
+    template<>
+    inline mutex_heap* make_target<mutex_heap>(int){
+        return new mutex_heap();
+    }
+
+    template<class Q>
+    struct concurrent_helper{
+        /** size events per producer and per time step, same time pattern than mh_bench */
+        static concurrent_result benchmark(int size, int threads, concurrent_mode mode, double max_time = 10.){
+            const double dt = 0.025;
+            const int steps = static_cast<int>(max_time/dt + 0.5);
+            const int ntargets = (mode == one_target) ? 1 : threads;
+            std::vector<Q*> targets(ntargets);
+            for(int i = 0; i < ntargets; ++i)
+                targets[i] = make_target<Q>(threads);
+
+            concurrent_result res;
+            unsigned long long int t0(0), t1(0);
+            unsigned long long int delivered(0), inversions(0);
+
+            #pragma omp parallel num_threads(threads) reduction(+:delivered,inversions)
+            {
+                const int id = omp_get_thread_num();
+                boost::random::mt19937 generator(id+1);
+                boost::random::uniform_real_distribution<double> distribution(0.5,2.0);
+                boost::random::uniform_int_distribution<int> target(0,ntargets-1);
+                std::vector<double> out;
+
+                for(int step = 0; step < steps; ++step){
+                    const double t = step*dt;
+                    #pragma omp barrier
+                    #pragma omp master
+                    t0 = rdtsc();
+
+                    for(int i = 0; i < size; ++i)
+                        targets[target(generator)]->push(id, t + distribution(generator));
+                    for(int i = 0; i < ntargets; ++i)
+                        targets[i]->flush(id);
+
+                    #pragma omp barrier
+                    #pragma omp master
+                    {
+                        t1 = rdtsc();
+                        res.push += t1 - t0;
+                    }
+
+                    if(id < ntargets){
+                        out.clear();
+                        targets[id]->drain_until(t, std::back_inserter(out));
+                        delivered += out.size();
+                        for(std::size_t i = 1; i < out.size(); ++i)
+                            inversions += (out[i] < out[i-1]);
+                    }
+
+                    #pragma omp barrier
+                    #pragma omp master
+                    res.drain += rdtsc() - t1;
+                }
+            }
+
+            res.events = static_cast<unsigned long long int>(size)*threads*steps;
+            res.delivered = delivered;
+            res.inversions = inversions;
+            for(int i = 0; i < ntargets; ++i)
+                delete targets[i];
+            return res;
+        }
+    };
+
+} //end namespace
+
+#endif
@@ -0,0 +1,108 @@
+/*
+ Copyright (c) 2016, Blue Brain Project
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without modification,
+ are permitted provided that the following conditions are met:
+ 1. Redistributions of source code must retain the above copyright notice,
+ this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright notice,
+ this list of conditions and the following disclaimer in the documentation
+ and/or other materials provided with the distribution.
+ 3. Neither the name of the copyright holder nor the names of its contributors
+ may be used to endorse or promote products derived from this software
+ without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef histogram_h_
+#define histogram_h_
+
+#include <vector>
+#include <cstddef>
+
+namespace queue {
+
+    /** HDR like histogram of latencies (cycles): exact below 32, then 32 linear sub
+        buckets per power of 2, so a value is known at 3% whatever is its magnitude.
+        Fixed memory (1920 counters), O(1) record, the max is exact */
+    class latency_histogram {
+    public:
+        typedef unsigned long long value_type;
+
+        latency_histogram():counts_(1920,0),count_(0),max_(0){}
+
+        inline void record(value_type v){
+            counts_[index(v)]++;
+            count_++;
+            if(v > max_)
+                max_ = v;
+        }
+
+        inline std::size_t count() const {
+            return count_;
+        }
+
+        inline value_type max() const {
+            return max_;
+        }
+
+        /** lowest value of the bucket of the percentile p (0 < p <= 100) */
+        value_type percentile(double p) const {
+            if(count_ == 0)
+                return 0;
+            std::size_t target = static_cast<std::size_t>(p/100.*count_ + 0.5);
+            if(target < 1)
+                target = 1;
+            if(target >= count_)
+                return max_;
+            std::size_t cumul = 0;
+            for(std::size_t i = 0; i < counts_.size(); ++i){
+                cumul += counts_[i];
+                if(cumul >= target)
+                    return (value(i) < max_) ? value(i) : max_;
+            }
+            return max_;
+        }
+
+    private:
+        static inline int msb(value_type v){
+            int n = 0;
+            while(v >>= 1)
+                ++n;
+            return n;
+        }
+
+        static inline std::size_t index(value_type v){
+            if(v < 32)
+                return static_cast<std::size_t>(v);
+            const int e = msb(v); // >= 5
+            return 32 + (e-5)*32 + static_cast<std::size_t>((v >> (e-5)) - 32);
+        }
+
+        static inline value_type value(std::size_t i){
+            if(i < 32)
+                return i;
+            const int e = static_cast<int>((i-32)/32) + 5;
+            return (32 + (i-32)%32) << (e-5);
+        }
+
+        std::vector<std::size_t> counts_;
+        std::size_t count_;
+        value_type max_;
+    };
+
+} //end namespace
+
+#endif
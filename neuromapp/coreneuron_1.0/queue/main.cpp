@@ -24,15 +24,21 @@
 #include <iostream>
 #include <fstream>
 #include <string>
+#include <vector>
+#include <limits>
+#include <algorithm>
 
 #include "utils/error.h"
 
 #include <boost/program_options.hpp>
 #include <boost/lexical_cast.hpp>
+#include <boost/type_traits/is_same.hpp>
 
 #include "coreneuron_1.0/queue/tool/priority_queue.hpp"
 #include "coreneuron_1.0/queue/trait.h"
 #include "coreneuron_1.0/queue/serial_benchmark.h"
+#include "coreneuron_1.0/queue/histogram.h"
+#include "coreneuron_1.0/queue/concurrent_benchmark.h"
 
 /** namespace alias for boost::program_options **/
 namespace po = boost::program_options;
@@ -48,9 +54,14 @@ int queue_help(int argc, char* const argv[], po::variables_map& vm){
     po::options_description desc("Allowed options");
     desc.add_options()
     ("help", "produce help message")
-    ("benchmark", po::value<std::string>()->default_value("push"), "push, pop, push_one, mh_bench or all")
+    ("benchmark", po::value<std::string>()->default_value("push"), "push, pop, push_one, mh_bench, drain, trace, concurrent or all (serial benchmarks only)")
+    ("trace", po::value<std::string>()->default_value(""), "trace file of the event miniapp for the trace benchmark")
     ("size", po::value<int>()->default_value(10), "bench = 2^size")
-    ("io", po::value<bool>()->default_value(false), "save $benchmark results IO i.e. pop.csv");
+    ("trials", po::value<int>()->default_value(5), "number of measured runs, mean and min are reported")
+    ("warmup", po::value<int>()->default_value(1), "number of runs dropped before the trials")
+    ("threads", po::value<int>()->default_value(0), "concurrent benchmark, max number of producers, 0 = OMP_NUM_THREADS")
+    ("mode", po::value<std::string>()->default_value("one"), "concurrent benchmark, one (P producers, 1 consumer) or all (P x P)")
+    ("io", po::value<bool>()->default_value(false), "save $benchmark results IO i.e. pop.csv and pop.json");
 
     po::store(po::parse_command_line(argc, argv, desc), vm);
     po::notify(vm);
@@ -63,30 +74,195 @@ int queue_help(int argc, char* const argv[], po::variables_map& vm){
     return mapp::MAPP_OK;
 }
 
+/** result of a (benchmark, queue, size), times in cycles */
+struct bench_result {
+    std::string name; // trait name of the queue
+    int size;
+    double mean; // mean of the trials
+    double min; // best trial
+    queue::latency_histogram latency; // per operation, sampled run
+};
+
+/** \fn measure(int size, int trials, int warmup, std::vector<bench_result>& res)
+ \brief warmup runs are dropped, then trials runs give the throughput, the latencies
+ are sampled in an extra run, the rdtsc per operation would bias the trials
+ */
+template<class T, container C>
+void measure(int size, int trials, int warmup, std::vector<bench_result>& res){
+    bench_result r;
+    r.name = helper_type<C>::name;
+    r.size = size;
+    r.mean = 0.;
+    r.min = std::numeric_limits<double>::max();
+
+    for(int i = 0; i < warmup; ++i)
+        T::template benchmark<helper_type<C> >(size);
+
+    for(int i = 0; i < trials; ++i){
+        double t = T::template benchmark<helper_type<C> >(size);
+        r.mean += t;
+        r.min = std::min(r.min, t);
+    }
+    r.mean /= trials;
+
+    T::template benchmark<helper_type<C> >(size, &r.latency);
+    res.push_back(r);
+}
+
+/** the table of the mean (one line per size) on the screen, the columns follow measure */
+void print_table(std::ostream& os, std::vector<bench_result> const& res){
+    os << "#elements";
+    for(std::size_t i = 0; i < res.size() && res[i].size == res[0].size; ++i)
+        os << "," << res[i].name;
+    os << "\n";
+    for(std::size_t i = 0; i < res.size(); ++i){
+        if(i == 0 || res[i].size != res[i-1].size)
+            os << (i == 0 ? "" : "\n") << res[i].size;
+        os << "," << res[i].mean;
+    }
+    os << "\n";
+}
+
+/** one line per (queue, size), easy to load with pandas/R */
+void write_csv(std::ostream& os, std::string const& bench, int trials, std::vector<bench_result> const& res){
+    os << "benchmark,queue,elements,trials,mean,min,p50,p99,p99.9,max,samples\n";
+    for(std::size_t i = 0; i < res.size(); ++i){
+        bench_result const& r = res[i];
+        os << bench << "," << r.name << "," << r.size << "," << trials << ","
+           << r.mean << "," << r.min << ","
+           << r.latency.percentile(50.) << "," << r.latency.percentile(99.) << ","
+           << r.latency.percentile(99.9) << "," << r.latency.max() << ","
+           << r.latency.count() << "\n";
+    }
+}
+
+void write_json(std::ostream& os, std::string const& bench, int trials, std::vector<bench_result> const& res){
+    os << "{\n  \"benchmark\": \"" << bench << "\",\n  \"unit\": \"cycles\",\n"
+       << "  \"trials\": " << trials << ",\n  \"results\": [\n";
+    for(std::size_t i = 0; i < res.size(); ++i){
+        bench_result const& r = res[i];
+        os << "    {\"queue\": \"" << r.name << "\", \"elements\": " << r.size
+           << ", \"mean\": " << r.mean << ", \"min\": " << r.min
+           << ", \"latency\": {\"p50\": " << r.latency.percentile(50.)
+           << ", \"p99\": " << r.latency.percentile(99.)
+           << ", \"p99.9\": " << r.latency.percentile(99.9)
+           << ", \"max\": " << r.latency.max()
+           << ", \"samples\": " << r.latency.count() << "}}"
+           << (i+1 < res.size() ? "," : "") << "\n";
+    }
+    os << "  ]\n}\n";
+}
+
 template<class T>
-void benchmark(int iteration, bool io){
+void benchmark(int iteration, int trials, int warmup, bool io){
     int size(1);
-    std::list<std::string> res;
-    res.push_back("#elements,std::priority_queue,sptq_queue,bin_queue,boost::binomial_heap,boost::fibonacci_heap,boost::skew_heap,boost::pairing_heap \n");
+    std::vector<bench_result> res;
 
     for(int i=1; i< iteration; ++i){
-        std::string bench = boost::lexical_cast<std::string>(size) + ",";
-        bench += boost::lexical_cast<std::string>(T::template benchmark<helper_type<priority_queue> >(size));
-        bench += boost::lexical_cast<std::string>(T::template benchmark<helper_type<sptq_queue> >(size)) + ",";
-        bench += boost::lexical_cast<std::string>(T::template benchmark<helper_type<bin_queue> >(size)) + ",";
-        bench += boost::lexical_cast<std::string>(T::template benchmark<helper_type<binomial_heap> >(size)) + ",";
-        bench += boost::lexical_cast<std::string>(T::template benchmark<helper_type<fibonacci_heap> >(size)) + ",";
-        bench += boost::lexical_cast<std::string>(T::template benchmark<helper_type<skew_heap> >(size)) + ",";
-        bench += boost::lexical_cast<std::string>(T::template benchmark<helper_type<d_ary_heap> >(size)) + "\n";
-        res.push_back(bench);
+        measure<T,priority_queue>(size,trials,warmup,res);
+        measure<T,sptq_queue>(size,trials,warmup,res);
+        measure<T,sptq_queue_malloc>(size,trials,warmup,res);
+        measure<T,bin_queue>(size,trials,warmup,res);
+        measure<T,bin_queue_malloc>(size,trials,warmup,res);
+        measure<T,ladder_queue>(size,trials,warmup,res);
+        if(!boost::is_same<T,queue::push_one_helper>::value) // not monotone, no meaning for the radix heap
+            measure<T,radix_queue>(size,trials,warmup,res);
+        measure<T,binomial_heap>(size,trials,warmup,res);
+        measure<T,fibonacci_heap>(size,trials,warmup,res);
+        measure<T,skew_heap>(size,trials,warmup,res);
+        measure<T,d_ary_heap>(size,trials,warmup,res);
         size<<=1; // 1,2,4,8 ....
     }
 
+    std::cout << "# " << T::name << ", mean of " << trials << " trials (cycles)\n";
+    print_table(std::cout, res); //screen
+
     if(io){
-        std::fstream out;
-        std::string name_file = boost::lexical_cast<std::string>(T::name) + ".csv";
-        out.open(name_file.c_str(),std::fstream::out);
-        std::copy(res.begin(),res.end(), std::ostream_iterator<std::string>(std::cout, " ")); //screen
+        std::string name = boost::lexical_cast<std::string>(T::name);
+        std::ofstream csv((name + ".csv").c_str());
+        write_csv(csv, name, trials, res);
+        std::ofstream json((name + ".json").c_str());
+        write_json(json, name, trials, res);
+    }
+}
+
+
+/** result of a concurrent strategy for a number of threads, cycles per event */
+struct concurrent_row {
+    std::string name;
+    int threads;
+    double push;
+    double drain;
+    unsigned long long int events;
+    unsigned long long int delivered;
+    unsigned long long int inversions;
+};
+
+template<class Q>
+void concurrent_measure(int size, int threads, queue::concurrent_mode mode, int trials, int warmup,
+                        std::vector<concurrent_row>& res){
+    concurrent_row r;
+    r.name = Q::name();
+    r.threads = threads;
+    r.push = r.drain = 0.;
+    r.events = r.delivered = r.inversions = 0;
+
+    for(int i = 0; i < warmup; ++i)
+        queue::concurrent_helper<Q>::benchmark(size, threads, mode);
+
+    for(int i = 0; i < trials; ++i){
+        queue::concurrent_result c = queue::concurrent_helper<Q>::benchmark(size, threads, mode);
+        r.push += c.push/static_cast<double>(c.events);
+        r.drain += c.drain/static_cast<double>(c.events);
+        r.events = c.events;
+        r.delivered = c.delivered;
+        r.inversions = c.inversions;
+    }
+    r.push /= trials;
+    r.drain /= trials;
+    res.push_back(r);
+}
+
+/** P producers with P = 1,2,4 ... threads, the three strategies for every P */
+void concurrent_benchmark(int iteration, int threads, queue::concurrent_mode mode, int trials, int warmup, bool io){
+    const int size = 1 << std::max(iteration-1,0); // events per producer and per time step
+    const std::string mode_name = (mode == queue::one_target) ? "one" : "all";
+    std::vector<concurrent_row> res;
+
+    for(int p = 1; p <= threads; p = (p < threads && 2*p > threads) ? threads : 2*p){
+        concurrent_measure<queue::mutex_heap>(size,p,mode,trials,warmup,res);
+        concurrent_measure<queue::multi_queue>(size,p,mode,trials,warmup,res);
+        concurrent_measure<queue::sorted_runs>(size,p,mode,trials,warmup,res);
+    }
+
+    std::cout << "# concurrent, mode " << mode_name << ", " << size << " events per producer and time step, "
+              << "mean of " << trials << " trials (cycles per event)\n";
+    std::cout << "#threads,mutex_heap,multi_queue,sorted_runs,multi_queue_inversions\n";
+    for(std::size_t i = 0; i+2 < res.size(); i += 3){
+        std::cout << res[i].threads;
+        for(std::size_t j = i; j < i+3; ++j)
+            std::cout << "," << res[j].push + res[j].drain;
+        std::cout << "," << res[i+1].inversions/static_cast<double>(std::max(res[i+1].delivered,1ULL)) << "\n";
+    }
+
+    if(io){
+        std::ofstream csv("concurrent.csv");
+        csv << "benchmark,mode,strategy,threads,events,delivered,push,drain,total,inversions\n";
+        for(std::size_t i = 0; i < res.size(); ++i)
+            csv << "concurrent," << mode_name << "," << res[i].name << "," << res[i].threads << ","
+                << res[i].events << "," << res[i].delivered << "," << res[i].push << ","
+                << res[i].drain << "," << res[i].push + res[i].drain << "," << res[i].inversions << "\n";
+
+        std::ofstream json("concurrent.json");
+        json << "{\n  \"benchmark\": \"concurrent\",\n  \"unit\": \"cycles per event\",\n"
+             << "  \"mode\": \"" << mode_name << "\",\n  \"trials\": " << trials << ",\n  \"results\": [\n";
+        for(std::size_t i = 0; i < res.size(); ++i)
+            json << "    {\"strategy\": \"" << res[i].name << "\", \"threads\": " << res[i].threads
+                 << ", \"events\": " << res[i].events << ", \"delivered\": " << res[i].delivered
+                 << ", \"push\": " << res[i].push << ", \"drain\": " << res[i].drain
+                 << ", \"inversions\": " << res[i].inversions << "}"
+                 << (i+1 < res.size() ? "," : "") << "\n";
+        json << "  ]\n}\n";
     }
 }
 
@@ -103,33 +279,70 @@ int queue_content(po::variables_map const& vm){
     if(iteration < 0)
         return mapp::MAPP_BAD_ARG;
 
+    int trials = vm["trials"].as<int>();
+    int warmup = vm["warmup"].as<int>();
+    if(trials < 1 || warmup < 0)
+        return mapp::MAPP_BAD_ARG;
+
     bool io = vm["io"].as<bool>();
 
+    std::string trace = vm["trace"].as<std::string>();
+    if(!trace.empty() && !tool::read_trace(trace, queue::trace_helper::records())){
+        std::cout << "can not read the trace " << trace << std::endl;
+        return mapp::MAPP_BAD_ARG;
+    }
+
     std::map<std::string,queue::benchs> m;
     m.insert(std::make_pair("push",queue::push));
     m.insert(std::make_pair("pop",queue::pop));
     m.insert(std::make_pair("push_one",queue::push_one));
     m.insert(std::make_pair("mh_bench",queue::mh_bench));
+    m.insert(std::make_pair("drain",queue::drain));
+    m.insert(std::make_pair("trace",queue::trace));
+    m.insert(std::make_pair("concurrent",queue::concurrent));
     m.insert(std::make_pair("all",queue::all));
 
     switch(m[bench]){
         case queue::push :
-            benchmark<queue::push_helper>(iteration,io);
+            benchmark<queue::push_helper>(iteration,trials,warmup,io);
             break;
         case queue::pop :
-            benchmark<queue::pop_helper>(iteration,io);
+            benchmark<queue::pop_helper>(iteration,trials,warmup,io);
             break;
         case queue::push_one :
-            benchmark<queue::push_one_helper>(iteration,io);
+            benchmark<queue::push_one_helper>(iteration,trials,warmup,io);
             break;
         case queue::mh_bench :
-            benchmark<queue::mhines_bench_helper>(iteration,io);
+            benchmark<queue::mhines_bench_helper>(iteration,trials,warmup,io);
+            break;
+        case queue::drain :
+            benchmark<queue::drain_helper>(iteration,trials,warmup,io);
+            break;
+        case queue::trace :
+            if(trace.empty())
+                return mapp::MAPP_BAD_ARG;
+            benchmark<queue::trace_helper>(iteration,trials,warmup,io);
+            break;
+        case queue::concurrent :
+        {
+            int threads = vm["threads"].as<int>();
+            if(threads == 0)
+                threads = omp_get_max_threads();
+            std::string mode = vm["mode"].as<std::string>();
+            if(threads < 0 || (mode != "one" && mode != "all"))
+                return mapp::MAPP_BAD_ARG;
+            concurrent_benchmark(iteration,threads,(mode == "one") ? queue::one_target : queue::all_targets,
+                                 trials,warmup,io);
             break;
+        }
         case queue::all :
-            benchmark<queue::push_helper>(iteration,io);
-            benchmark<queue::pop_helper>(iteration,io);
-            benchmark<queue::push_one_helper>(iteration,io);
-            benchmark<queue::mhines_bench_helper>(iteration,io);
+            benchmark<queue::push_helper>(iteration,trials,warmup,io);
+            benchmark<queue::pop_helper>(iteration,trials,warmup,io);
+            benchmark<queue::push_one_helper>(iteration,trials,warmup,io);
+            benchmark<queue::mhines_bench_helper>(iteration,trials,warmup,io);
+            benchmark<queue::drain_helper>(iteration,trials,warmup,io);
+            if(!trace.empty())
+                benchmark<queue::trace_helper>(iteration,trials,warmup,io);
             break;
         default:
             return mapp::MAPP_BAD_ARG;
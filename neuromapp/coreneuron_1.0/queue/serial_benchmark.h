@@ -9,19 +9,60 @@
 #ifndef serial_benchmark_h
 #define serial_benchmark_h
 
+#include <vector>
+#include <iterator>
+
 #include <boost/random/mersenne_twister.hpp>
 #include <boost/random/uniform_real_distribution.hpp>
 
 #include "coreneuron_1.0/queue/timer_asm.h"
+#include "coreneuron_1.0/queue/tool/trace.h"
+#include "coreneuron_1.0/queue/histogram.h"
 
 
 namespace queue{
 
-    enum benchs {push=1,pop,push_one,mh_bench,all}; // for the main and switch
+    enum benchs {push=1,pop,push_one,mh_bench,drain,trace,concurrent,all}; // for the main and switch
+
+    /** the benchmarks return the mean time (cycles) of the measured section. If a histogram
+        is given, the latency of every push/pop/drain of the section is also recorded, it costs
+        two rdtsc per operation, so the mean of a sampled run is not the throughput */
+    template<class Q, class V>
+    inline void push_op(Q& queue, V v, latency_histogram* h){
+        if(h){
+            unsigned long long int t = rdtsc();
+            queue.push(v);
+            h->record(rdtsc() - t);
+        }else{
+            queue.push(v);
+        }
+    }
+
+    template<class Q>
+    inline void pop_op(Q& queue, latency_histogram* h){
+        if(h){
+            unsigned long long int t = rdtsc();
+            queue.pop();
+            h->record(rdtsc() - t);
+        }else{
+            queue.pop();
+        }
+    }
+
+    template<class Q, class OutputIt>
+    inline void drain_op(Q& queue, double t, OutputIt out, latency_histogram* h){
+        if(h){
+            unsigned long long int t0 = rdtsc();
+            tool::drain_until(queue, t, out);
+            h->record(rdtsc() - t0);
+        }else{
+            tool::drain_until(queue, t, out);
+        }
+    }
 
     struct push_helper{
         template<class T>
-        static double benchmark(int size, int repetition = 5){
+        static double benchmark(int size, latency_histogram* h = 0, int repetition = 5){
             typedef typename T::value_type value_type;
             boost::random::mt19937 generator;
             boost::random::uniform_real_distribution<double> distribution(0.0,1.0);
@@ -31,7 +72,7 @@ namespace queue{
             for(int j=0; j<repetition; ++j){
                 t1 = rdtsc();
                 for(int i = 0; i < size ; ++i)
-                    queue.push(distribution(generator));
+                    push_op(queue, distribution(generator), h);
                 t2 = rdtsc();
 
                 while(!queue.empty())
@@ -49,7 +90,7 @@ namespace queue{
 
     struct pop_helper{
         template<class T>
-        static double benchmark(int size, int repetition = 5){
+        static double benchmark(int size, latency_histogram* h = 0, int repetition = 5){
             typedef typename T::value_type value_type;
             boost::random::mt19937 generator;
             boost::random::uniform_real_distribution<double> distribution(0.0,1.0);
@@ -62,7 +103,7 @@ namespace queue{
 
                 t1 = rdtsc();
                 while(!queue.empty())
-                    queue.pop();
+                    pop_op(queue, h);
                 t2 = rdtsc();
 
                 time += (t2 - t1);
@@ -77,7 +118,7 @@ namespace queue{
 
     struct push_one_helper{
         template<class T>
-        static double benchmark(int size, int repetition = 10){
+        static double benchmark(int size, latency_histogram* h = 0, int repetition = 10){
             typedef typename T::value_type value_type;
             unsigned long long int t1(0),t2(0),time(0);
             boost::random::mt19937 generator;
@@ -90,7 +131,7 @@ namespace queue{
             for(int j=0; j<repetition; ++j){
                 typename value_type::value_type value = distribution(generator);
                 t1 = rdtsc();
-                queue.push(value);
+                push_op(queue, value, h);
                 t2 = rdtsc();
                 time += (t2 - t1);
                 queue.pop(); // keep the number of element constant
@@ -106,7 +147,7 @@ namespace queue{
     struct mhines_bench_helper {
 
         template<class T>
-        static double benchmark(int size, int repetition = 2){
+        static double benchmark(int size, latency_histogram* h = 0, int repetition = 2){
             repetition=1;
             typedef typename T::value_type value_type;
             boost::random::mt19937 generator;
@@ -125,7 +166,7 @@ namespace queue{
                         queue.push((t + distribution(generator)));
 
                     while (queue.top() <= t)
-                        queue.pop();
+                        pop_op(queue, h);
 
                     t += dt;
                 }
@@ -141,6 +182,95 @@ namespace queue{
 
     const char mhines_bench_helper::name[] = "mh_bench";
 
+    /** same pattern than mh_bench, but the events of a time step are pushed with a single
+        push_bulk and delivered with a single drain_until in a buffer */
+    struct drain_helper {
+
+        template<class T>
+        static double benchmark(int size, latency_histogram* h = 0, int repetition = 1){
+            typedef typename T::value_type value_type;
+            boost::random::mt19937 generator;
+            boost::random::uniform_real_distribution<double> distribution(0.5,2.0);
+            unsigned long long int t1(0),t2(0),time(0);
+
+            const double dt = 0.025;
+            const double max_time = 50.0;
+            std::vector<double> in(size);
+            std::vector<double> out;
+
+            for(int j=0; j<repetition; ++j){
+                value_type queue;
+                t1 = rdtsc();
+
+                for(double t=0.0; t < max_time; t += dt){
+                    for(int i = 0; i < size ; ++i)
+                        in[i] = t + distribution(generator);
+                    tool::push_bulk(queue, in.begin(), in.end());
+
+                    out.clear();
+                    drain_op(queue, t, std::back_inserter(out), h);
+                }
+
+                t2 = rdtsc();
+                time += (t2 - t1);
+            }
+            return time*1/static_cast<double>(repetition);
+        }
+
+        static const char name[];
+    };
+
+    const char drain_helper::name[] = "drain";
+
+    /** replay a trace recorded by the event_passing miniapp (option --trace), the
+        size is the number of replays of the full trace, a new queue per replay */
+    struct trace_helper {
+
+        /** the records of the trace, loaded once by the main */
+        static std::vector<tool::trace_record>& records(){
+            static std::vector<tool::trace_record> r;
+            return r;
+        }
+
+        template<class T>
+        static double benchmark(int size, latency_histogram* h = 0, int repetition = 1){
+            typedef typename T::value_type value_type;
+            const std::vector<tool::trace_record>& r = records();
+            unsigned long long int t1(0),t2(0),time(0);
+            std::vector<double> out;
+
+            for(int j=0; j<repetition; ++j){
+                t1 = rdtsc();
+                for(int k = 0; k < size; ++k){
+                    value_type queue;
+                    for(std::size_t i = 0; i < r.size(); ++i){
+                        const double t = r[i].t_;
+                        switch(r[i].op_){
+                            case tool::trace_push :
+                                push_op(queue, t, h);
+                                break;
+                            case tool::trace_pop :
+                                if(!queue.empty() && queue.top() <= t)
+                                    pop_op(queue, h);
+                                break;
+                            case tool::trace_drain :
+                                out.clear();
+                                drain_op(queue, t, std::back_inserter(out), h);
+                                break;
+                        }
+                    }
+                }
+                t2 = rdtsc();
+                time += (t2 - t1);
+            }
+            return time*1/static_cast<double>(repetition);
+        }
+
+        static const char name[];
+    };
+
+    const char trace_helper::name[] = "trace";
+
 } //end namespace
 
 #endif /* push_pop_h */
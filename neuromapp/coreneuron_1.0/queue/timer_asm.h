@@ -1,3 +1,6 @@
+#ifndef timer_asm_h
+#define timer_asm_h
+
 
 
 
@@ -25,4 +28,6 @@
         result = result|lower;
         return(result);
     }
-#endif
\ No newline at end of file
+#endif
+
+#endif
@@ -31,6 +31,13 @@
 
 namespace tool { // namespace si better than C style
 
+    /** time of an element of a queue, the element itself for the arithmetic types,
+        overload it in the namespace of a structure (found by ADL) */
+    template<class T>
+    inline double time_of(const T& t){
+        return static_cast<double>(t);
+    }
+
     // idem for every queue,
     template<class Q> // Q is a queue
     inline void move(Q& q, typename Q::node_type* n,  typename Q::value_type value){
@@ -38,6 +45,25 @@ namespace tool { // namespace si better than C style
         new_n->t_ = value; // attribute a new value
         q.push(new_n); // reinsert in the queue
     }
+
+    /** remove all the elements <= t of a queue with the smallest element on top and copy
+        them in out, increasing order. Generic version for the std and boost queues,
+        the queues of tool provide a native version */
+    template<class Q, class OutputIt>
+    inline OutputIt drain_until(Q& q, typename Q::value_type t, OutputIt out){
+        while(!q.empty() && !(t < q.top())){
+            *out++ = q.top();
+            q.pop();
+        }
+        return out;
+    }
+
+    /** push a range in a queue, generic version */
+    template<class Q, class InputIt>
+    inline void push_bulk(Q& q, InputIt first, InputIt last){
+        for(; first != last; ++first)
+            q.push(*first);
+    }
     
 } // end namespace
 
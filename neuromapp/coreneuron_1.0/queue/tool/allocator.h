@@ -0,0 +1,120 @@
+/*
+ Copyright (c) 2016, Blue Brain Project
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without modification,
+ are permitted provided that the following conditions are met:
+ 1. Redistributions of source code must retain the above copyright notice,
+ this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright notice,
+ this list of conditions and the following disclaimer in the documentation
+ and/or other materials provided with the distribution.
+ 3. Neither the name of the copyright holder nor the names of its contributors
+ may be used to endorse or promote products derived from this software
+ without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef allocator_h_
+#define allocator_h_
+
+#include <new>
+#include <vector>
+#include <cstddef>
+
+namespace tool {
+
+    /** node allocator of the original queues, one new/delete per event */
+    template<class N>
+    struct new_allocator {
+        typedef N node_type;
+        typedef typename N::value_type value_type;
+
+        inline node_type* allocate(value_type v){
+            return new node_type(v);
+        }
+
+        inline void deallocate(node_type* n){
+            delete n;
+        }
+    };
+
+    /** node allocator with a free list on top of slabs. The pool belongs to the queue,
+     and a queue is only used by its own thread, so the pool is thread local without
+     any lock or TLS. The slabs are only given back when the queue is destroyed.
+     A copy of the allocator starts with an empty pool, the slabs are never shared */
+    template<class N>
+    class pool_allocator {
+        // a slot holds a node or the link of the free list
+        union slot {
+            slot* next_;
+            char node_[sizeof(N)];
+            double align_;
+        };
+
+    public:
+        typedef N node_type;
+        typedef typename N::value_type value_type;
+
+        explicit pool_allocator(std::size_t chunk = 256):chunk_(chunk),next_(0),end_(0),free_(0){}
+
+        pool_allocator(const pool_allocator& other):chunk_(other.chunk_),next_(0),end_(0),free_(0){}
+
+        pool_allocator& operator=(const pool_allocator&){
+            return *this; // keep my own slabs
+        }
+
+        ~pool_allocator(){
+            for(std::size_t i = 0; i < slabs_.size(); ++i)
+                delete [] slabs_[i];
+        }
+
+        inline node_type* allocate(value_type v){
+            slot* s;
+            if(free_){
+                s = free_;
+                free_ = free_->next_;
+            }else{
+                if(next_ == end_)
+                    grow();
+                s = next_++;
+            }
+            return new(s) node_type(v);
+        }
+
+        inline void deallocate(node_type* n){
+            n->~node_type();
+            slot* s = reinterpret_cast<slot*>(n);
+            s->next_ = free_;
+            free_ = s;
+        }
+
+    private:
+        void grow(){
+            next_ = new slot[chunk_];
+            end_ = next_ + chunk_;
+            slabs_.push_back(next_);
+            chunk_ <<= 1; // double the size of the next slab
+        }
+
+        std::size_t chunk_;
+        slot* next_; // first never used slot of the last slab
+        slot* end_;
+        slot* free_; // free list
+        std::vector<slot*> slabs_;
+    };
+
+} // end namespace
+
+#endif
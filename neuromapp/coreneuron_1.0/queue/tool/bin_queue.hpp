@@ -2,17 +2,28 @@
 #ifndef bin_queue_hpp_
 #define bin_queue_hpp_
 
-#include "coreneuron_1.0/queue/tool/bin_queue.hpp"
+#include <vector>
+#include <cstddef>
+
+#include "coreneuron_1.0/queue/tool/algorithm.h"
+#include "coreneuron_1.0/queue/tool/allocator.h"
 
 namespace tool {
 
 /** the bin queue is a a kind of priority_queue using a ring concept, elements are sorted through
     bin from smallest to largest, into a bin there is NO specific order*. The determination
     of the bin is choosen by a kind of hash function (the hash give the bin "bucket").
-    Into a bin with have a single link list using the "left" link of the bin_node class.
+    Into a bin with have a double link list using the "left" (next) and "right" (previous)
+    links of the bin_node class, so a node is removed in O(1) without walking the bin.
+
+    The bins are a ring: a bin is reused when the window [qpt_, qpt_ + bins_.size()) moves
+    forward with the time, the ring only grows when the pending events span more bins than
+    the ring size. An occupancy bitmap (one bit per bin, plus a summary bit per word) gives
+    the next non empty bin with a find first set, no linear scan of the empty bins.
 
     Objectively this queue is designed only for our problem because we are hashing "time"
-    using the inverse of dt. Consequently, genericity with template is useless
+    using the inverse of dt. Consequently, genericity with template is useless, the
+    time of an element is given by time_of
 
     I remove the array and use a std::vector to have a safe resize
  */
@@ -21,27 +32,35 @@ namespace tool {
     template<class T>
     struct bin_node {
         typedef T value_type;
-        explicit bin_node(value_type t = value_type()):t_(t),left_(0),cnt_(-1){};
+        explicit bin_node(value_type t = value_type()):t_(t),left_(0),right_(0),cnt_(-1){};
         value_type t_;
-        bin_node* left_;
-        int cnt_;
+        bin_node* left_; // next node of the bin
+        bin_node* right_; // previous node of the bin
+        int cnt_; // absolute bin number
     };
 
-    template<class T>
+    template<class T, class Alloc = pool_allocator<bin_node<T> > >
     class bin_queue {
     public:
         typedef T value_type;
         typedef std::size_t size_type;
         typedef bin_node<value_type> node_type;
+        typedef Alloc allocator_type;
+
+        inline explicit bin_queue(double dt = 0.025, double t0 = 0.):size_(0),qpt_(0),last_(0),dt_(dt),tt_(t0){
+            resize(1024);
+        }
 
-        inline explicit bin_queue(double dt = 0.025, value_type t0 = 0.):size_(0),qpt_(0),dt_(dt),tt_(t0)
-                                                                             ,bins_(1024){}
+        /** deep copy, the nodes are pushed again in my own allocator */
+        bin_queue(const bin_queue& other);
+
+        bin_queue& operator=(const bin_queue& other);
 
         ~bin_queue();
 
         /** std::priority_queue API like */
         inline void push(value_type t){
-            node_type* n = new node_type(t);
+            node_type* n = alloc_.allocate(t);
             enqueue(t,n); // t encapsulate in the bin_node but also needed for the "hash function"
             size_++;
         }
@@ -55,7 +74,7 @@ namespace tool {
             if(!empty()){
                 node_type* q = first();
                 remove(q);
-                delete q;
+                alloc_.deallocate(q);
                 size_--;
             }
         }
@@ -69,11 +88,11 @@ namespace tool {
             return r;
         }
 
-        inline size_type size(){
+        inline size_type size() const {
             return size_;
         }
 
-        inline bool empty(){
+        inline bool empty() const {
             return !bool(size_); // is it true on Power?
         }
         
@@ -83,6 +102,19 @@ namespace tool {
             return n;
         }
 
+        /** remove all the elements <= t and copy them in out, the bins before the bin of t
+            are emptied in one shot without any comparison, only the bin of t is filtered.
+            Like pop, the elements come bin by bin with no order into a bin */
+        template<class OutputIt>
+        OutputIt drain_until(value_type t, OutputIt out);
+
+        /** push a range, O(1) per element */
+        template<class InputIt>
+        void push_bulk(InputIt first, InputIt last){
+            for(; first != last; ++first)
+                push(static_cast<value_type>(*first));
+        }
+
     private:
         /** original API */
         inline void enqueue(value_type tt, tool::bin_node<value_type>*);
@@ -91,13 +123,56 @@ namespace tool {
         node_type* first();
         node_type* next(node_type*);
         void remove(node_type*);
-    
+
+        /** bin of the time td, the hash function */
+        inline int bin(value_type td) const {
+            int rev_dt = 1/dt_;
+            return (int)((time_of(td) - tt_)*rev_dt + 1.e-10);
+        }
+
+        /** copy/destruction */
+        void copy(const bin_queue& other);
+        void clear();
+
+        /** ring management */
+        void resize(size_type n);
+        void grow(size_type span);
+        inline void link(node_type* q);
+        inline void clear_bit(size_type p);
+        inline int find_set(size_type from) const;
+        inline int find_ring(size_type from) const;
+
+        /** position of the absolute bin i into the ring */
+        inline size_type ring(int i) const {
+            return static_cast<size_type>(i) & mask_;
+        }
+
+        /** absolute bin of the ring position p, the window starts at qpt_ */
+        inline int absolute(size_type p) const {
+            return qpt_ + static_cast<int>((p - ring(qpt_)) & mask_);
+        }
+
         size_type size_;
-        int qpt_; // unused here
+        int qpt_; // first bin of the window, no event before
+        int last_; // upper bound of the last non empty bin
         double dt_; // step times
-        value_type tt_; // time at beginning of qpt_ interval
-        std::vector<node_type*> bins_; // for correct resize
+        double tt_; // time at beginning of bin 0
+        size_type mask_; // bins_.size() - 1, power of 2
+        std::vector<node_type*> bins_; // the ring
+        std::vector<unsigned long long> bits_; // one bit per bin, set if non empty
+        std::vector<unsigned long long> summary_; // one bit per word of bits_, set if non zero
+        allocator_type alloc_; // new/delete or pool for the nodes
     };
+
+    template<class T, class Alloc, class OutputIt>
+    inline OutputIt drain_until(bin_queue<T,Alloc>& q, typename bin_queue<T,Alloc>::value_type t, OutputIt out){
+        return q.drain_until(t,out);
+    }
+
+    template<class T, class Alloc, class InputIt>
+    inline void push_bulk(bin_queue<T,Alloc>& q, InputIt first, InputIt last){
+        q.push_bulk(first,last);
+    }
 }
 
 #include "bin_queue.ipp"
@@ -1,72 +1,243 @@
-
 #ifndef bin_queue_ipp_
 #define bin_queue_ipp_
 
+#include <cassert>
+#include <algorithm>
+
 #include "coreneuron_1.0/queue/tool/algorithm.h" //for the sptq::bin_node object
 
 namespace tool{
 
-    template<class T>
-    bin_queue<T>::~bin_queue() {
+    /** index of the first set bit of a non zero word */
+    inline int bin_ctz(unsigned long long w){
+#if defined(__GNUC__)
+        return __builtin_ctzll(w);
+#else
+        int n = 0;
+        while(!(w & 1ULL)){
+            w >>= 1;
+            ++n;
+        }
+        return n;
+#endif
+    }
+
+    template<class T, class Alloc>
+    bin_queue<T,Alloc>::bin_queue(const bin_queue& other):size_(0),qpt_(0),last_(0),dt_(other.dt_),tt_(other.tt_){
+        resize(other.bins_.size());
+        copy(other);
+    }
+
+    template<class T, class Alloc>
+    bin_queue<T,Alloc>& bin_queue<T,Alloc>::operator=(const bin_queue& other) {
+        if(this != &other){
+            clear();
+            dt_ = other.dt_;
+            tt_ = other.tt_;
+            resize(other.bins_.size());
+            copy(other);
+        }
+        return *this;
+    }
+
+    template<class T, class Alloc>
+    bin_queue<T,Alloc>::~bin_queue() {
+        clear();
+    }
+
+    template<class T, class Alloc>
+    void bin_queue<T,Alloc>::copy(const bin_queue& other) {
+        for(size_type p = 0; p < other.bins_.size(); ++p)
+            for(node_type* q = other.bins_[p]; q; q = q->left_)
+                push(q->t_);
+    }
+
+    template<class T, class Alloc>
+    void bin_queue<T,Alloc>::clear() {
         node_type* q, *q2;
         for (q = first(); q; q = q2) {
             q2 = next(q);
             remove(q); /// Potentially dereferences freed pointer this->sptree_
-            delete q;
+            alloc_.deallocate(q);
         }
+        size_ = 0;
     }
 
-    template<class T>
-    void bin_queue<T>::enqueue(T td, node_type* q) {
+    template<class T, class Alloc>
+    void bin_queue<T,Alloc>::enqueue(T td, node_type* q) {
 
-        int rev_dt = 1/dt_;
-        int idt = (int)((td - tt_)*rev_dt + 1.e-10);
-        if(idt >= bins_.size())
-            bins_.resize(idt<<1); //double the size
+        int idt = bin(td);
         assert(idt >= 0);
-        if(idt < qpt_)
-            qpt_ = idt; // keep track of the first bin
-        q->cnt_ = idt; // only for iteration
-        q->left_ = bins_[idt];
-        bins_[idt] = q;
-    }
-
-    template<class T>
-    typename bin_queue<T>::node_type* bin_queue<T>::first() {
-        for (int i = qpt_; i < bins_.size(); ++i) {
-            if (bins_[i]) {
-                qpt_ = i; // keep track of the first bin
-                return bins_[i];
+        const int n = static_cast<int>(bins_.size());
+        if(size_ == 0){
+            qpt_ = idt; // empty, the window starts where we want
+            last_ = idt;
+        }else{
+            if(idt < qpt_){
+                if(last_ - idt >= n)
+                    grow(last_ - idt + 1);
+                qpt_ = idt; // keep track of the first bin
+            }else if(idt - qpt_ >= n){
+                first(); // move the window to the first non empty bin
+                if(idt - qpt_ >= n)
+                    grow(idt - qpt_ + 1);
             }
+            last_ = std::max(last_, idt);
         }
-        return 0;
+        q->cnt_ = idt;
+        link(q);
+    }
+
+    template<class T, class Alloc>
+    typename bin_queue<T,Alloc>::node_type* bin_queue<T,Alloc>::first() {
+        const size_type p0 = ring(qpt_);
+        if(bins_[p0])
+            return bins_[p0]; // usual case, the first bin did not move
+        int p = find_ring(p0);
+        if(p < 0)
+            return 0;
+        qpt_ = absolute(p); // keep track of the first bin
+        return bins_[p];
     }
 
-    template<class T>
-    typename bin_queue<T>::node_type* bin_queue<T>::next(node_type* q) {
+    template<class T, class Alloc>
+    typename bin_queue<T,Alloc>::node_type* bin_queue<T,Alloc>::next(node_type* q) {
         if (q->left_) { return q->left_; }
-        for (int i = q->cnt_ + 1; i < bins_.size(); ++i) {
-            if (bins_[i]) {
-                return bins_[i];
+        const size_type from = ring(q->cnt_ + 1);
+        int p = find_ring(from);
+        if(p < 0)
+            return 0;
+        // we went around the ring, the bin is before q
+        int i = q->cnt_ + 1 + static_cast<int>((p - from) & mask_);
+        if(i >= qpt_ + static_cast<int>(bins_.size()))
+            return 0;
+        return bins_[p];
+    }
+
+    template<class T, class Alloc>
+    void bin_queue<T,Alloc>::remove(node_type* q) {
+        const size_type p = ring(q->cnt_);
+        if(q->right_)
+            q->right_->left_ = q->left_;
+        else
+            bins_[p] = q->left_;
+        if(q->left_)
+            q->left_->right_ = q->right_;
+        q->left_ = 0;
+        q->right_ = 0;
+        if(!bins_[p])
+            clear_bit(p);
+    }
+
+    template<class T, class Alloc>
+    void bin_queue<T,Alloc>::clear_bit(size_type p) {
+        bits_[p>>6] &= ~(1ULL << (p & 63));
+        if(!bits_[p>>6])
+            summary_[p>>12] &= ~(1ULL << ((p>>6) & 63));
+    }
+
+    template<class T, class Alloc>
+    template<class OutputIt>
+    OutputIt bin_queue<T,Alloc>::drain_until(T t, OutputIt out) {
+        const int last = bin(t);
+        node_type* q;
+        while((q = first()) != NULL && qpt_ <= last){
+            const size_type p = ring(qpt_);
+            if(qpt_ < last){
+                // the full bin is before t
+                bins_[p] = 0;
+                clear_bit(p);
+                while(q){
+                    node_type* q2 = q->left_;
+                    *out++ = q->t_;
+                    alloc_.deallocate(q);
+                    size_--;
+                    q = q2;
+                }
+            }else{
+                // the bin of t, no order into a bin
+                while(q){
+                    node_type* q2 = q->left_;
+                    if(!(time_of(t) < time_of(q->t_))){
+                        *out++ = q->t_;
+                        remove(q);
+                        alloc_.deallocate(q);
+                        size_--;
+                    }
+                    q = q2;
+                }
+                break;
             }
         }
-        return 0;
+        return out;
+    }
+
+    template<class T, class Alloc>
+    void bin_queue<T,Alloc>::link(node_type* q) {
+        const size_type p = ring(q->cnt_);
+        q->right_ = 0;
+        q->left_ = bins_[p];
+        if(q->left_)
+            q->left_->right_ = q;
+        bins_[p] = q;
+        bits_[p>>6] |= 1ULL << (p & 63);
+        summary_[p>>12] |= 1ULL << ((p>>6) & 63);
     }
 
-    template<class T>
-    void bin_queue<T>::remove(node_type* q) {
-        node_type* q1, *q2;
-        q1 = bins_[q->cnt_];
-        if (q1 == q) {
-            bins_[q->cnt_] = q->left_;
-            return;
+    template<class T, class Alloc>
+    void bin_queue<T,Alloc>::resize(size_type n) {
+        assert(n >= 64 && !(n & (n-1))); // power of 2, at least one word
+        bins_.assign(n, 0);
+        mask_ = n - 1;
+        bits_.assign(n >> 6, 0ULL);
+        summary_.assign((bits_.size() + 63) >> 6, 0ULL);
+    }
+
+    template<class T, class Alloc>
+    void bin_queue<T,Alloc>::grow(size_type span) {
+        std::vector<node_type*> nodes;
+        nodes.reserve(size_);
+        for(size_type p = 0; p < bins_.size(); ++p)
+            for(node_type* q = bins_[p]; q; q = q->left_)
+                nodes.push_back(q);
+
+        size_type n = bins_.size() << 1; //double the size
+        while(n < span)
+            n <<= 1;
+        resize(n);
+
+        for(size_type i = 0; i < nodes.size(); ++i)
+            link(nodes[i]);
+    }
+
+    template<class T, class Alloc>
+    int bin_queue<T,Alloc>::find_set(size_type from) const {
+        size_type w = from >> 6;
+        if(w >= bits_.size())
+            return -1;
+        unsigned long long word = bits_[w] & (~0ULL << (from & 63));
+        if(word)
+            return static_cast<int>((w << 6) + bin_ctz(word));
+        // next non zero word with the summary
+        size_type s = w + 1;
+        while(s < bits_.size()){
+            const size_type sw = s >> 6;
+            unsigned long long sword = summary_[sw] & (~0ULL << (s & 63));
+            if(sword){
+                const size_type k = (sw << 6) + bin_ctz(sword);
+                return static_cast<int>((k << 6) + bin_ctz(bits_[k]));
+            }
+            s = (sw + 1) << 6;
         }
-        for (q2 = q1->left_; q2; q1 = q2, q2 = q2->left_) {
-            if (q2 == q) {
-                q1->left_ = q->left_;
-                return;
-            }   
-        }   
+        return -1;
+    }
+
+    template<class T, class Alloc>
+    int bin_queue<T,Alloc>::find_ring(size_type from) const {
+        int p = find_set(from);
+        if(p < 0 && from > 0)
+            p = find_set(0); // around the ring
+        return p;
     }
 }
 
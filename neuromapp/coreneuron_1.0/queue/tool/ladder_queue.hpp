@@ -0,0 +1,163 @@
+/*
+ Copyright (c) 2016, Blue Brain Project
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without modification,
+ are permitted provided that the following conditions are met:
+ 1. Redistributions of source code must retain the above copyright notice,
+ this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright notice,
+ this list of conditions and the following disclaimer in the documentation
+ and/or other materials provided with the distribution.
+ 3. Neither the name of the copyright holder nor the names of its contributors
+ may be used to endorse or promote products derived from this software
+ without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef ladder_queue_hpp_
+#define ladder_queue_hpp_
+
+#include <vector>
+#include <limits>
+#include <cstddef>
+
+#include "coreneuron_1.0/queue/tool/algorithm.h"
+
+namespace tool {
+
+/** The ladder queue (Tang, Goh and Thng, ACM TOMACS 2005) is a calendar queue with a
+    self-adjusting number of bucket levels. It is made of three parts:
+
+    - top: an unsorted list, receives every event later than the current epoch
+    - rungs: a ladder of bucket arrays, every rung spreads one bucket of the rung
+      above it (or the whole top for the first rung) over its own buckets
+    - bottom: a small sorted list where the events are finally popped
+
+    The events are only sorted when a bucket with less than thres_ events reaches
+    the bottom, so push and pop are O(1) amortized whatever is the time distribution.
+    Like the bin_queue, the API mimics std::priority_queue with std::greater
+    (the top is the smallest time), no comparator, the time of an element is
+    given by time_of.
+ */
+
+    //rung of the ladder, a calendar of buckets
+    template<class T>
+    struct ladder_rung {
+        typedef T value_type;
+        explicit ladder_rung(double start = 0., double width = 0., std::size_t n = 0)
+            :start_(start),width_(width),cur_(0),buckets_(n){}
+        double start_; // time of the first bucket
+        double width_; // time width of a bucket
+        std::size_t cur_; // first non dequeued bucket
+        std::vector<std::vector<value_type> > buckets_;
+    };
+
+    template<class T>
+    class ladder_queue {
+    public:
+        typedef T value_type;
+        typedef std::size_t size_type;
+        typedef ladder_rung<value_type> rung_type;
+
+        inline explicit ladder_queue(size_type thres = 50, size_type max_rungs = 8):size_(0),thres_(thres),
+                                     nrungs_(0),top_start_(-std::numeric_limits<double>::max()),
+                                     top_min_(std::numeric_limits<double>::max()),
+                                     top_max_(-std::numeric_limits<double>::max()),rungs_(max_rungs){}
+
+        /** std::priority_queue API like */
+        inline void push(value_type t){
+            enqueue(t);
+            size_++;
+        }
+
+        inline void pop(){
+            if(!empty()){
+                refill();
+                bottom_.pop_back();
+                size_--;
+            }
+        }
+
+        /* the top corresponds to the end of the bottom, the bottom is sorted by decreasing
+         time, to pop without moving the elements */
+        inline value_type top(){
+            value_type r = value_type();
+            if(!empty()){
+                refill();
+                r = bottom_.back();
+            }
+            return r;
+        }
+
+        inline size_type size() const {
+            return size_;
+        }
+
+        inline bool empty() const {
+            return !bool(size_);
+        }
+
+        /** remove all the elements <= t and copy them in out, increasing order,
+            the bottom is cut with a single binary search */
+        template<class OutputIt>
+        OutputIt drain_until(value_type t, OutputIt out);
+
+        /** push a range, the events later than the epoch are only appended to top */
+        template<class InputIt>
+        void push_bulk(InputIt first, InputIt last){
+            for(; first != last; ++first)
+                push(static_cast<value_type>(*first));
+        }
+
+    private:
+        // for intenal only
+        void enqueue(value_type t);
+        void insert_bottom(value_type t);
+        void refill();
+        void spawn_top();
+        bool spawn_bottom();
+        void spawn(std::vector<value_type>& v, double vmin, double vmax);
+        void sort_bottom(std::vector<value_type>& v);
+
+        /** time of the first non dequeued bucket of the rung i */
+        inline double rung_current(size_type i) const {
+            return rungs_[i].start_ + rungs_[i].width_*rungs_[i].cur_;
+        }
+
+        size_type size_;
+        size_type thres_; // max number of events sorted in one shot
+        size_type nrungs_; // number of active rungs
+        double top_start_; // epoch, event later than this go into top
+        double top_min_;
+        double top_max_;
+        std::vector<value_type> top_;
+        std::vector<rung_type> rungs_; // fixed number of rungs, no realloc
+        std::vector<value_type> bottom_; // sorted, decreasing time
+    };
+
+    template<class T, class OutputIt>
+    inline OutputIt drain_until(ladder_queue<T>& q, typename ladder_queue<T>::value_type t, OutputIt out){
+        return q.drain_until(t,out);
+    }
+
+    template<class T, class InputIt>
+    inline void push_bulk(ladder_queue<T>& q, InputIt first, InputIt last){
+        q.push_bulk(first,last);
+    }
+}
+
+#include "ladder_queue.ipp"
+
+#endif
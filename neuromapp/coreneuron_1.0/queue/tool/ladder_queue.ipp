@@ -0,0 +1,181 @@
+/*
+ Copyright (c) 2016, Blue Brain Project
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without modification,
+ are permitted provided that the following conditions are met:
+ 1. Redistributions of source code must retain the above copyright notice,
+ this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright notice,
+ this list of conditions and the following disclaimer in the documentation
+ and/or other materials provided with the distribution.
+ 3. Neither the name of the copyright holder nor the names of its contributors
+ may be used to endorse or promote products derived from this software
+ without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef ladder_queue_ipp_
+#define ladder_queue_ipp_
+
+#include <algorithm>
+#include <functional>
+
+namespace tool{
+
+    template<class T>
+    void ladder_queue<T>::enqueue(T t) {
+        const double d = time_of(t);
+
+        // later than the epoch, no order
+        if(d >= top_start_){
+            top_.push_back(t);
+            top_min_ = std::min(top_min_,d);
+            top_max_ = std::max(top_max_,d);
+            return;
+        }
+
+        // look for the rung, from the coarsest to the finest
+        for(size_type i = 0; i < nrungs_; ++i){
+            rung_type& r = rungs_[i];
+            if(r.cur_ < r.buckets_.size() && d >= rung_current(i)){
+                size_type k = static_cast<size_type>((d - r.start_)/r.width_);
+                k = std::max(k, r.cur_); // rounding
+                k = std::min(k, r.buckets_.size()-1);
+                r.buckets_[k].push_back(t);
+                return;
+            }
+        }
+
+        insert_bottom(t);
+    }
+
+    template<class T>
+    void ladder_queue<T>::insert_bottom(T t) {
+        // too many events to keep sorted, spread them on a new rung
+        if(bottom_.size() >= thres_ && spawn_bottom()){
+            enqueue(t);
+            return;
+        }
+        // lower_bound, equal times are popped in the FIFO order
+        typename std::vector<value_type>::iterator it = std::lower_bound(bottom_.begin(), bottom_.end(),
+                                                                         t, std::greater<value_type>());
+        bottom_.insert(it,t);
+    }
+
+    template<class T>
+    void ladder_queue<T>::refill() {
+        while(bottom_.empty()){
+            if(nrungs_ == 0){
+                if(top_.empty())
+                    return;
+                spawn_top();
+                continue;
+            }
+
+            rung_type& r = rungs_[nrungs_-1];
+            while(r.cur_ < r.buckets_.size() && r.buckets_[r.cur_].empty())
+                ++r.cur_;
+
+            // the rung is finished, go up
+            if(r.cur_ == r.buckets_.size()){
+                --nrungs_;
+                continue;
+            }
+
+            std::vector<value_type>& b = r.buckets_[r.cur_];
+            ++r.cur_;
+
+            double bmin = std::numeric_limits<double>::max();
+            double bmax = -std::numeric_limits<double>::max();
+            for(size_type i = 0; i < b.size(); ++i){
+                bmin = std::min(bmin, time_of(b[i]));
+                bmax = std::max(bmax, time_of(b[i]));
+            }
+
+            if(b.size() > thres_ && nrungs_ < rungs_.size() && bmax > bmin){
+                spawn(b, bmin, bmax); // the bucket is too large, go down
+            }else{
+                bottom_.swap(b); // bottom is empty, b keeps its capacity
+                sort_bottom(bottom_);
+            }
+        }
+    }
+
+    template<class T>
+    void ladder_queue<T>::spawn_top() {
+        top_start_ = top_max_; // new epoch
+        if(top_.size() > thres_ && top_max_ > top_min_){
+            spawn(top_, top_min_, top_max_);
+        }else{
+            bottom_.swap(top_);
+            sort_bottom(bottom_);
+        }
+        top_min_ = std::numeric_limits<double>::max();
+        top_max_ = -std::numeric_limits<double>::max();
+    }
+
+    template<class T>
+    bool ladder_queue<T>::spawn_bottom() {
+        if(nrungs_ == rungs_.size())
+            return false;
+        const double bmin = time_of(bottom_.back());
+        const double bmax = time_of(bottom_.front());
+        if(!(bmax > bmin))
+            return false;
+        spawn(bottom_, bmin, bmax);
+        return true;
+    }
+
+    template<class T>
+    void ladder_queue<T>::spawn(std::vector<T>& v, double vmin, double vmax) {
+        const size_type n = v.size();
+        rung_type& r = rungs_[nrungs_++];
+        r.start_ = vmin;
+        r.width_ = (vmax - vmin)/n;
+        r.cur_ = 0;
+        r.buckets_.resize(n+1); // +1 for vmax
+        for(size_type i = 0; i < n; ++i){
+            size_type k = static_cast<size_type>((time_of(v[i]) - vmin)/r.width_);
+            k = std::min(k, n);
+            r.buckets_[k].push_back(v[i]);
+        }
+        v.clear();
+    }
+
+    template<class T>
+    template<class OutputIt>
+    OutputIt ladder_queue<T>::drain_until(T t, OutputIt out) {
+        while(!empty()){
+            refill();
+            // bottom is decreasing, the elements <= t are at the end
+            typename std::vector<value_type>::iterator it = std::lower_bound(bottom_.begin(), bottom_.end(),
+                                                                             t, std::greater<value_type>());
+            out = std::copy(bottom_.rbegin(), typename std::vector<value_type>::reverse_iterator(it), out);
+            size_ -= std::distance(it, bottom_.end());
+            const bool done = (it != bottom_.begin());
+            bottom_.erase(it, bottom_.end());
+            if(done)
+                break;
+        }
+        return out;
+    }
+
+    template<class T>
+    void ladder_queue<T>::sort_bottom(std::vector<T>& v) {
+        std::sort(v.begin(), v.end(), std::greater<value_type>());
+    }
+}
+
+#endif
@@ -34,5 +34,9 @@
 #include "coreneuron_1.0/queue/tool/bin_queue.ipp"
 #include "coreneuron_1.0/queue/tool/sptq_queue.hpp"
 #include "coreneuron_1.0/queue/tool/sptq_queue.ipp"
+#include "coreneuron_1.0/queue/tool/ladder_queue.hpp"
+#include "coreneuron_1.0/queue/tool/ladder_queue.ipp"
+#include "coreneuron_1.0/queue/tool/radix_queue.hpp"
+#include "coreneuron_1.0/queue/tool/radix_queue.ipp"
 
 #endif
\ No newline at end of file
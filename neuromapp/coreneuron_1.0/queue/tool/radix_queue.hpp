@@ -0,0 +1,173 @@
+/*
+ Copyright (c) 2016, Blue Brain Project
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without modification,
+ are permitted provided that the following conditions are met:
+ 1. Redistributions of source code must retain the above copyright notice,
+ this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright notice,
+ this list of conditions and the following disclaimer in the documentation
+ and/or other materials provided with the distribution.
+ 3. Neither the name of the copyright holder nor the names of its contributors
+ may be used to endorse or promote products derived from this software
+ without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef radix_queue_hpp_
+#define radix_queue_hpp_
+
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <cstddef>
+
+#include "coreneuron_1.0/queue/tool/algorithm.h"
+
+namespace tool {
+
+/** The radix heap (Ahuja, Mehlhorn, Orlin and Tarjan, J. ACM 1990) is a monotone priority
+    queue: the elements pushed are never earlier than the last popped one, what is always
+    true for the delivery of the events (time steps). The key is the time (time_of) mapped
+    on 64 bits keeping the order, the bucket i holds the keys which differ from the last
+    popped key by their bit i-1 (most significant), the bucket 0 the keys equal to it.
+
+    When the bucket 0 is empty, the first non empty bucket is spread over the smaller
+    ones from its minimum, an element only goes down so push/pop are O(1) amortized
+    (at most 64 moves). The buckets are std::vector, no node, the memory access is linear.
+
+    top() and a drain_until() which stops early spread a bucket without popping its minimum,
+    the origin of the buckets (last_) is then later than the last popped key (floor_). An
+    element between the two is not late, it goes in a small binary heap (early_) which is
+    emptied before the buckets. An element earlier than the last popped one (not monotone)
+    is late, it is due now and is pushed with the key of the last pop. The floor goes back
+    to 0 when the queue is empty. Like the bin_queue, the API mimics std::priority_queue
+    with std::greater (the top is the smallest time), no comparator.
+ */
+
+    template<class T>
+    class radix_queue {
+    public:
+        typedef T value_type;
+        typedef std::size_t size_type;
+        typedef unsigned long long key_type;
+        typedef std::pair<key_type,value_type> entry_type;
+
+        inline radix_queue():size_(0),last_(0),floor_(0),buckets_(65){}
+
+        /** std::priority_queue API like */
+        inline void push(value_type t){
+            key_type k = key(t);
+            if(k < floor_)
+                k = floor_; // late, due now
+            if(k < last_){
+                early_.push_back(entry_type(k,t));
+                std::push_heap(early_.begin(), early_.end(), entry_greater());
+            }else{
+                buckets_[bucket(k)].push_back(entry_type(k,t));
+            }
+            size_++;
+        }
+
+        inline void pop(){
+            if(!empty()){
+                if(!early_.empty()){
+                    floor_ = early_.front().first;
+                    std::pop_heap(early_.begin(), early_.end(), entry_greater());
+                    early_.pop_back();
+                }else{
+                    refill();
+                    floor_ = last_;
+                    buckets_[0].pop_back();
+                }
+                popped(1);
+            }
+        }
+
+        inline value_type top(){
+            value_type r = value_type();
+            if(!empty()){
+                if(!early_.empty())
+                    return early_.front().second;
+                refill();
+                r = buckets_[0].back().second;
+            }
+            return r;
+        }
+
+        inline size_type size() const {
+            return size_;
+        }
+
+        inline bool empty() const {
+            return !bool(size_);
+        }
+
+        /** remove all the elements <= t and copy them in out, increasing order,
+            the bucket 0 is copied in one shot */
+        template<class OutputIt>
+        OutputIt drain_until(value_type t, OutputIt out);
+
+        /** push a range, O(1) per element */
+        template<class InputIt>
+        void push_bulk(InputIt first, InputIt last){
+            for(; first != last; ++first)
+                push(*first);
+        }
+
+        /** the key, the double is read as an integer, the order is kept with a flip
+            of the sign bit for the positive and of all the bits for the negative */
+        static inline key_type key(const value_type& t);
+
+    private:
+        /** min heap on the key */
+        struct entry_greater {
+            inline bool operator()(const entry_type& a, const entry_type& b) const {
+                return a.first > b.first;
+            }
+        };
+
+        // for intenal only
+        void refill();
+
+        inline void popped(size_type n){
+            size_ -= n;
+            if(size_ == 0)
+                last_ = floor_ = 0;
+        }
+
+        inline size_type bucket(key_type k) const;
+
+        size_type size_;
+        key_type last_; // origin of the buckets, the minimum of the buckets
+        key_type floor_; // key of the last popped element, <= last_
+        std::vector<entry_type> early_; // heap of the keys in [floor_, last_)
+        std::vector<std::vector<entry_type> > buckets_; // 65 buckets, 0 for last_
+    };
+
+    template<class T, class OutputIt>
+    inline OutputIt drain_until(radix_queue<T>& q, typename radix_queue<T>::value_type t, OutputIt out){
+        return q.drain_until(t,out);
+    }
+
+    template<class T, class InputIt>
+    inline void push_bulk(radix_queue<T>& q, InputIt first, InputIt last){
+        q.push_bulk(first,last);
+    }
+}
+
+#include "radix_queue.ipp"
+
+#endif
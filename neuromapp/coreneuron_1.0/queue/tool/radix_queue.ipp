@@ -0,0 +1,114 @@
+/*
+ Copyright (c) 2016, Blue Brain Project
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without modification,
+ are permitted provided that the following conditions are met:
+ 1. Redistributions of source code must retain the above copyright notice,
+ this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright notice,
+ this list of conditions and the following disclaimer in the documentation
+ and/or other materials provided with the distribution.
+ 3. Neither the name of the copyright holder nor the names of its contributors
+ may be used to endorse or promote products derived from this software
+ without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef radix_queue_ipp_
+#define radix_queue_ipp_
+
+#include <cstring>
+#include <limits>
+
+namespace tool{
+
+    /** number of leading zero of a non zero word */
+    inline int radix_clz(unsigned long long w){
+#if defined(__GNUC__)
+        return __builtin_clzll(w);
+#else
+        int n = 0;
+        while(!(w & (1ULL << 63))){
+            w <<= 1;
+            ++n;
+        }
+        return n;
+#endif
+    }
+
+    template<class T>
+    typename radix_queue<T>::key_type radix_queue<T>::key(const T& t) {
+        const double d = time_of(t); // ADL, the time of an event
+        key_type k;
+        std::memcpy(&k, &d, sizeof(k));
+        return (k >> 63) ? ~k : (k | (1ULL << 63));
+    }
+
+    template<class T>
+    typename radix_queue<T>::size_type radix_queue<T>::bucket(key_type k) const {
+        return (k == last_) ? 0 : 64 - radix_clz(k ^ last_);
+    }
+
+    template<class T>
+    void radix_queue<T>::refill() {
+        if(!buckets_[0].empty())
+            return;
+
+        size_type i = 1;
+        while(buckets_[i].empty())
+            ++i;
+
+        std::vector<entry_type>& b = buckets_[i];
+        key_type kmin = std::numeric_limits<key_type>::max();
+        for(size_type j = 0; j < b.size(); ++j)
+            if(b[j].first < kmin)
+                kmin = b[j].first;
+
+        last_ = kmin;
+        for(size_type j = 0; j < b.size(); ++j)
+            buckets_[bucket(b[j].first)].push_back(b[j]); // always a smaller bucket than i
+        b.clear();
+    }
+
+    template<class T>
+    template<class OutputIt>
+    OutputIt radix_queue<T>::drain_until(T t, OutputIt out) {
+        const key_type kt = key(t);
+        while(!early_.empty() && early_.front().first <= kt){
+            floor_ = early_.front().first;
+            *out++ = early_.front().second;
+            std::pop_heap(early_.begin(), early_.end(), entry_greater());
+            early_.pop_back();
+            popped(1);
+        }
+        if(!early_.empty())
+            return out; // the buckets are later
+        while(!empty()){
+            refill(); // may move last_ over kt, only floor_ bounds the pushes
+            if(last_ > kt)
+                break;
+            std::vector<entry_type>& b = buckets_[0];
+            for(size_type j = 0; j < b.size(); ++j)
+                *out++ = b[j].second;
+            floor_ = last_;
+            const size_type n = b.size();
+            b.clear();
+            popped(n);
+        }
+        return out;
+    }
+}
+
+#endif
@@ -34,8 +34,10 @@ THE POSSIBILITY OF SUCH DAMAGE.
 #include <cstring>
 #include <ostream>
 #include <functional>
+#include <vector>
 
 #include "coreneuron_1.0/queue/tool/algorithm.h"
+#include "coreneuron_1.0/queue/tool/allocator.h"
 
 namespace tool {
 /** The queue: TQeue from Michael starts here, not compliant with std for the container,
@@ -80,26 +82,39 @@ sptq_node<T>* sphead(SPTREE<T>*);
 template<class T>
 void spdelete(sptq_node<T>*,SPTREE<T>*);
 
-template<class T = double, class Compare = std::less<T> >
+template<class T = double, class Compare = std::less<T>, class Alloc = pool_allocator<sptq_node<T> > >
 class sptq_queue {
 public:
     typedef SPTREE<T> container;
     typedef std::size_t size_type;
     typedef T value_type;
     typedef sptq_node<T> node_type;
+    typedef Alloc allocator_type;
 
     inline sptq_queue():size_(0) {
         spinit(&q);
     }
 
+    /** deep copy, the nodes are pushed again in my own allocator */
+    sptq_queue(const sptq_queue& other):size_(0) {
+        spinit(&q);
+        copy(other);
+    }
+
+    sptq_queue& operator=(const sptq_queue& other){
+        if(this != &other){
+            clear();
+            copy(other);
+        }
+        return *this;
+    }
+
     inline ~sptq_queue(){
-        node_type *n;
-        while((n = spdeq(&(&q)->root)) != NULL)
-          delete n;
+        clear();
     }
 
     inline void push(value_type value){
-        node_type *n = new node_type(value);
+        node_type *n = alloc_.allocate(value);
         spenq<T,Compare>(n, &q); // the Comparator is use only here
         size_++;
     }
@@ -112,7 +127,7 @@ public:
     inline void pop(){
         if(!empty()){
             node_type *n = spdeq(&(&q)->root);
-            delete n; // pop remove definitively the element else memory leak
+            alloc_.deallocate(n); // pop remove definitively the element else memory leak
             size_--;
         }
     }
@@ -124,11 +139,11 @@ public:
         return tmp;
     }
 
-    inline size_type size(){
+    inline size_type size() const {
         return size_;
     }
 
-    inline bool empty(){
+    inline bool empty() const {
         return !bool(size_); // is it true on Power?
     }
 
@@ -138,6 +153,31 @@ public:
         return n;
     }
 
+    /** remove all the elements up to t (in the order of the queue, time <= t with
+        std::greater) and copy them in out, the head stays the root of the tree
+        so every element is removed in O(1) */
+    template<class OutputIt>
+    OutputIt drain_until(value_type t, OutputIt out){
+        Compare c;
+        node_type *n;
+        while((n = sphead<T>(&q)) != NULL && !c(n->t_,t)){
+            *out++ = n->t_;
+            q.root = n->right_; // the head has no left son
+            if(q.root != NULL)
+                q.root->parent_ = NULL;
+            alloc_.deallocate(n);
+            size_--;
+        }
+        return out;
+    }
+
+    /** push a range, the splay tree has no better bulk insertion */
+    template<class InputIt>
+    void push_bulk(InputIt first, InputIt last){
+        for(; first != last; ++first)
+            push(*first);
+    }
+
     void print(std::ostream &os) {
         while(!empty()){
             os << top() << std::endl;
@@ -146,13 +186,47 @@ public:
     }
 
 private:
+    void clear(){
+        node_type *n;
+        while((n = spdeq(&(&q)->root)) != NULL)
+          alloc_.deallocate(n);
+        size_ = 0;
+    }
+
+    void copy(const sptq_queue& other){
+        std::vector<const node_type*> stack;
+        if(other.q.root != NULL)
+            stack.push_back(other.q.root);
+        while(!stack.empty()){
+            const node_type* n = stack.back();
+            stack.pop_back();
+            push(n->t_);
+            if(n->left_ != NULL)
+                stack.push_back(n->left_);
+            if(n->right_ != NULL)
+                stack.push_back(n->right_);
+        }
+    }
+
     size_type size_;
     container q;
+    allocator_type alloc_; // new/delete or pool for the nodes
 };
 
+template<class T, class Compare, class Alloc, class OutputIt>
+inline OutputIt drain_until(sptq_queue<T,Compare,Alloc>& q, typename sptq_queue<T,Compare,Alloc>::value_type t,
+                            OutputIt out){
+    return q.drain_until(t,out);
+}
+
+template<class T, class Compare, class Alloc, class InputIt>
+inline void push_bulk(sptq_queue<T,Compare,Alloc>& q, InputIt first, InputIt last){
+    q.push_bulk(first,last);
+}
+
 // carefull the << delete the queue only for debugging 
-template<class T, class Compare>
-std::ostream& operator<< (std::ostream& os, sptq_queue<T,Compare>& q ){
+template<class T, class Compare, class Alloc>
+std::ostream& operator<< (std::ostream& os, sptq_queue<T,Compare,Alloc>& q ){
     q.print(os);
     return os;
 }
@@ -0,0 +1,94 @@
+/*
+ Copyright (c) 2016, Blue Brain Project
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without modification,
+ are permitted provided that the following conditions are met:
+ 1. Redistributions of source code must retain the above copyright notice,
+ this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright notice,
+ this list of conditions and the following disclaimer in the documentation
+ and/or other materials provided with the distribution.
+ 3. Neither the name of the copyright holder nor the names of its contributors
+ may be used to endorse or promote products derived from this software
+ without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef trace_h_
+#define trace_h_
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace tool {
+
+    /** operations of a trace of a priority queue */
+    enum trace_op {trace_push = 'p', // push(t_)
+                   trace_pop = 'o', // one pop if top <= t_
+                   trace_drain = 'd'}; // pop all the elements <= t_
+
+    /** a record of the trace, written on 9 bytes (op, time) */
+    struct trace_record {
+        explicit trace_record(char op = trace_push, double t = 0.):op_(op),t_(t){}
+        char op_;
+        double t_;
+    };
+
+    /** binary trace: "NMQT", the number of records (8 bytes), then the records on
+     9 bytes (op, double), native endianness. Return false if the file can not be written */
+    inline bool write_trace(const std::string& file, const std::vector<trace_record>& records){
+        FILE* f = std::fopen(file.c_str(), "wb");
+        if(f == NULL)
+            return false;
+        unsigned long long n = records.size();
+        bool ok = std::fwrite("NMQT", 1, 4, f) == 4 && std::fwrite(&n, sizeof(n), 1, f) == 1;
+        char buffer[9];
+        for(std::size_t i = 0; ok && i < records.size(); ++i){
+            buffer[0] = records[i].op_;
+            std::memcpy(buffer+1, &records[i].t_, sizeof(double));
+            ok = std::fwrite(buffer, 1, 9, f) == 9;
+        }
+        std::fclose(f);
+        return ok;
+    }
+
+    /** read a trace written by write_trace, the records are appended to records.
+        Return false if the file can not be read or is not a trace */
+    inline bool read_trace(const std::string& file, std::vector<trace_record>& records){
+        FILE* f = std::fopen(file.c_str(), "rb");
+        if(f == NULL)
+            return false;
+        char magic[4];
+        unsigned long long n = 0;
+        bool ok = std::fread(magic, 1, 4, f) == 4 && std::memcmp(magic, "NMQT", 4) == 0
+                  && std::fread(&n, sizeof(n), 1, f) == 1;
+        char buffer[9];
+        for(unsigned long long i = 0; ok && i < n; ++i){
+            ok = std::fread(buffer, 1, 9, f) == 9;
+            if(ok){
+                trace_record r(buffer[0]);
+                std::memcpy(&r.t_, buffer+1, sizeof(double));
+                records.push_back(r);
+            }
+        }
+        std::fclose(f);
+        return ok;
+    }
+
+} // end namespace
+
+#endif
@@ -19,7 +19,8 @@
 #include "coreneuron_1.0/queue/tool/priority_queue.hpp" // MH work
 
 enum container {sptq_queue, bin_queue, priority_queue,binomial_heap,
-                fibonacci_heap,pairing_heap,skew_heap,d_ary_heap};
+                fibonacci_heap,pairing_heap,skew_heap,d_ary_heap,ladder_queue,
+                sptq_queue_malloc, bin_queue_malloc, radix_queue};
 //serial queue
 template<container q>
 struct helper_type;
@@ -42,6 +43,32 @@ struct helper_type<bin_queue>{ // no comparator great by default
     const static char name[];
 };
 
+// same queues, with a new/delete per node instead of the pool (the
+// allocation of the original code, the default ones are named *_pool)
+template<>
+struct helper_type<sptq_queue_malloc>{
+    typedef tool::sptq_queue<double, std::greater<double>, tool::new_allocator<tool::sptq_node<double> > > value_type;
+    const static char name[];
+};
+
+template<>
+struct helper_type<bin_queue_malloc>{
+    typedef tool::bin_queue<double, tool::new_allocator<tool::bin_node<double> > > value_type;
+    const static char name[];
+};
+
+template<>
+struct helper_type<ladder_queue>{ // no comparator great by default
+    typedef tool::ladder_queue<double> value_type;
+    const static char name[];
+};
+
+template<>
+struct helper_type<radix_queue>{ // monotone, no comparator great by default
+    typedef tool::radix_queue<double> value_type;
+    const static char name[];
+};
+
 template<>
 struct helper_type<binomial_heap>{
     typedef boost::heap::binomial_heap<double, boost::heap::compare<std::greater<double> > > value_type;
@@ -74,12 +101,16 @@ struct helper_type<d_ary_heap>{
 
 //because no c++11
 const char helper_type<priority_queue>::name[] = "std::priority_queue";
-const char helper_type<sptq_queue>::name[] = "original_sptq_queue";
-const char helper_type<bin_queue>::name[] = "original_bin_queue";
+const char helper_type<sptq_queue>::name[] = "sptq_queue_pool";
+const char helper_type<bin_queue>::name[] = "bin_queue_pool";
+const char helper_type<sptq_queue_malloc>::name[] = "sptq_queue_malloc";
+const char helper_type<bin_queue_malloc>::name[] = "bin_queue_malloc";
+const char helper_type<ladder_queue>::name[] = "ladder_queue";
+const char helper_type<radix_queue>::name[] = "radix_queue";
 const char helper_type<binomial_heap>::name[] = "boost::binomial_heap";
 const char helper_type<fibonacci_heap>::name[] = "boost::fibonacci_heap";
 const char helper_type<pairing_heap>::name[] = "boost::pairing_heap";
 const char helper_type<skew_heap>::name[] = "boost::skew_heap";
-const char helper_type<d_ary_heap>::name[] = "boost::d_aray_heap";
+const char helper_type<d_ary_heap>::name[] = "boost::d_ary_heap";
 
 #endif /* trait_h */
@@ -29,7 +29,12 @@
 #include <cassert>
 #include <sys/time.h>
 #include <vector>
+#include <string>
+#include <sstream>
+#include <algorithm>
+#include <numeric>
 #include "utils/storage/neuromapp_data.h"
+#include "utils/mpi/timeline.h"
 
 // Get OMP header if available
 #include "utils/omp/compatibility.h"
@@ -39,7 +44,7 @@
 
 
 int main(int argc, char* argv[]) {
-    assert(argc == 16);
+    assert(argc == 18);
 
     MPI_Init(NULL, NULL);
     int rank, size;
@@ -62,6 +67,8 @@ int main(int argc, char* argv[]) {
     double syn_tau_rec = boost::lexical_cast<double>(argv[13]);
     double syn_tau_fac = boost::lexical_cast<double>(argv[14]);
     bool pool = boost::lexical_cast<bool>(argv[15]);
+    std::string timeline(argv[16]); // prefix of the chrome trace files, none if no timeline
+    std::string cost(argv[17]); // none (contiguous), lognormal or a file of per gid costs (balanced)
 
     namespace po = boost::program_options;
     po::variables_map vm;
@@ -87,7 +94,18 @@ int main(int argc, char* argv[]) {
 
     const double firing_rate = static_cast<double>(nSpikes) / static_cast<double>(simtime);
 
-    environment::continousdistribution neuro_dist(size, rank, ncells);
+    std::vector<double> costs;
+    environment::neurondistribution* distribution =
+        environment::make_distribution(cost, size, rank, ncells, costs);
+    if(!distribution){
+        if(rank == 0)
+            std::cout<<"cannot read "<<ncells<<" cell costs from "<<cost<<std::endl;
+        MPI_Finalize();
+        return 1;
+    }
+    environment::neurondistribution& neuro_dist = *distribution;
+    //cost of every virtual process
+    std::vector<double> vp_cost(nthreads, 0.);
 
     //environment::generate_poisson_events(generator.begin(),
     //                          simtime, nthreads, rank, size, firing_interval, &neuro_dist);
@@ -114,19 +132,46 @@ int main(int argc, char* argv[]) {
         const int num_threads = omp_get_num_threads();
 
         //neuron distribution on thread based on rank distribution
-        environment::continousdistribution neuron_vp_dist(num_threads, thrd, &neuro_dist);
+        environment::neurondistribution* vp_distribution =
+            environment::make_distribution(num_threads, thrd, &neuro_dist, costs);
+        const environment::neurondistribution& neuron_vp_dist = *vp_distribution;
+        if(!costs.empty())
+            vp_cost[thrd] = environment::local_cost(neuron_vp_dist, costs);
         //generate events for each thread
         environment::event_generator::iterator it_gen_vp = generator.begin();
         std::advance(it_gen_vp, thrd);
         generate_poisson_events_neuron(it_gen_vp, 1234, simtime, firing_rate/static_cast<double>(neuron_vp_dist.getglobalcells()), neuron_vp_dist);
         //build up network
         nest::build_connections_from_neuron(thrd, neuron_vp_dist, presyns, detectors_targetindex, cn);
+        delete vp_distribution;
+    }
+
+    if(!costs.empty()){
+        //max over mean of the cost of the ranks and of the virtual processes
+        double load[4] = {environment::local_cost(neuro_dist, costs), 0.,
+                          *std::max_element(vp_cost.begin(), vp_cost.end()), 0.};
+        load[1] = load[0];
+        load[3] = std::accumulate(vp_cost.begin(), vp_cost.end(), 0.);
+        MPI_Allreduce(MPI_IN_PLACE, &load[0], 1, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+        MPI_Allreduce(MPI_IN_PLACE, &load[1], 1, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+        MPI_Allreduce(MPI_IN_PLACE, &load[2], 1, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+        MPI_Allreduce(MPI_IN_PLACE, &load[3], 1, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+        if(rank == 0){
+            std::cout<<"cost imbalance of the ranks: "<<load[0]*size/load[1]<<" balanced, "
+                     <<environment::contiguous_imbalance(size, costs)<<" contiguous"<<std::endl;
+            std::cout<<"cost imbalance of the threads: "<<load[2]*size*nthreads/load[3]<<" balanced, "
+                     <<environment::contiguous_imbalance(size*nthreads, costs)<<" contiguous"<<std::endl;
+        }
     }
 
     nest::eventdelivermanager edm(cn, size, nthreads, mindelay);
     nest::simulationmanager sm(edm, generator, rank, size, nthreads);
 
 
+    mapp::timeline* tl = NULL;
+    if(timeline != "none")
+        tl = new mapp::timeline(nthreads);
+
     struct timeval start, end;
     //run simulation
     gettimeofday(&start, NULL);
@@ -144,12 +189,18 @@ int main(int argc, char* argv[]) {
             #pragma omp barrier
 
             // deliver only from second time step on
-            if (t>0)
+            if (t>0){
+                mapp::timeline_scope scope(tl, thrd, mapp::deliver_phase);
                 edm.deliver_events(thrd, t);
-            sm.update(thrd, t, from_step, to_step);
+            }
+            {
+                mapp::timeline_scope scope(tl, thrd, mapp::update_phase);
+                sm.update(thrd, t, from_step, to_step);
+            }
             #pragma omp barrier
             #pragma omp master
             {
+                mapp::timeline_scope scope(tl, thrd, mapp::exchange_phase);
                 edm.gather_events();
             }
             
@@ -172,10 +223,11 @@ int main(int argc, char* argv[]) {
     int l_num = 0;
     double  l_sumtime = 0;
     for (int thrd=0; thrd<nthreads; thrd++) {
-    environment::continousdistribution neuro_vp_dist(nthreads, thrd, &neuro_dist);
+    environment::neurondistribution* neuro_vp_dist =
+        environment::make_distribution(nthreads, thrd, &neuro_dist, costs);
     int vp_num = 0;
     for(unsigned int i=0; i < num_detectors; ++i) {	
-        if (neuro_vp_dist.isLocal(i)) {
+        if (neuro_vp_dist->isLocal(i)) {
         //std::cout << i << ": num_recv=" << detectors[i].num << std::endl; 
         vp_num += detectors[i].num;
         l_num += detectors[i].num;
@@ -183,6 +235,7 @@ int main(int argc, char* argv[]) {
         }
     }
     std::cout << "thrd=" << thrd << " vp_num="<< vp_num << std::endl;
+    delete neuro_vp_dist;
     }
     int g_num;
     MPI_Reduce( &l_num, &g_num, 1, MPI_INT, MPI_SUM, 0, MPI_COMM_WORLD );
@@ -194,9 +247,19 @@ int main(int argc, char* argv[]) {
         std::cout<<"statistics: num_recv="<< g_num << " acc_spike_times=" << g_sumtime << std::endl;
     }
 
+    if(tl){
+        std::stringstream file;
+        file << timeline << "_" << rank << ".json";
+        if(!tl->write_chrome(file.str(), rank))
+            std::cout<<"Rank: "<<rank<<" could not write the timeline "<<file.str()<<std::endl;
+        tl->summary(MPI_COMM_WORLD);
+        delete tl;
+    }
+
     //pl.accumulate_stats();
     //accumulate_stats(s_interface);
 
+    delete distribution;
     MPI_Finalize();
     return 0;
 }
@@ -70,7 +70,7 @@ namespace nest {
 
 
     /*
-     * \fn build_connections_from_neuron(const thread& thrd, const environment::continousdistribution& neuron_dist,const environment::presyn_maker& presyns,const std::vector<targetindex>& detectors_targetindex,connectionmanager& cm)
+     * \fn build_connections_from_neuron(const thread& thrd, const environment::neurondistribution& neuron_dist,const environment::presyn_maker& presyns,const std::vector<targetindex>& detectors_targetindex,connectionmanager& cm)
      * \brief build connections in connection manager using generator from coreneuron miniapp
      * \param neuro_vp_dist used neuron distribution
      * \param presyns network object from coreneuron
@@ -78,7 +78,7 @@ namespace nest {
      * \param cm reference to connection manager
      */
     void build_connections_from_neuron(const thread& thrd,
-                                       const environment::continousdistribution& neuron_dist,
+                                       const environment::neurondistribution& neuron_dist,
                                        const environment::presyn_maker& presyns,
                                        const std::vector<targetindex>& detectors_targetindex,
                                        connectionmanager& cm)
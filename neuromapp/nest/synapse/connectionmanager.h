@@ -42,7 +42,7 @@ namespace nest
     };
 
     void build_connections_from_neuron(const thread& thrd,
-                                       const environment::continousdistribution& neuro_vp_dist,
+                                       const environment::neurondistribution& neuro_vp_dist,
                                        const environment::presyn_maker& presyns,
                                        const std::vector<targetindex>& detectors_targetindex,
                                        connectionmanager& cm);
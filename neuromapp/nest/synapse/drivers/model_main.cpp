@@ -123,7 +123,9 @@ namespace nest
         if (use_mpi)
             desc.add_options()
             ("run", po::value<std::string>()->default_value("/usr/bin/mpiexec"), "mpi run command")
-            ("rate", po::value<double>()->default_value(-1), "firing rate per neuron");
+            ("rate", po::value<double>()->default_value(-1), "firing rate per neuron")
+            ("timeline", po::value<std::string>()->default_value("none"), "record the phases of every thread in $timeline_rank.json (chrome trace format)")
+            ("cost", po::value<std::string>()->default_value("none"), "the distribution of the neurons: none (contiguous), lognormal (synthetic cost per neuron) or a file with the cost of every gid (balanced on the ranks and the threads)");
 
         if (use_manager)
             desc.add_options()
@@ -285,6 +287,8 @@ namespace nest
             double syn_tau_rec = vm["tau_rec"].as<double>();
             double syn_tau_fac = vm["tau_fac"].as<double>();
             bool pool = vm["pool"].as<bool>();
+            std::string timeline = vm["timeline"].as<std::string>();
+            std::string cost = vm["cost"].as<std::string>();
 
             std::string exec ="nest_dist_exec";
 
@@ -296,7 +300,7 @@ namespace nest
                 syn_model << " " << syn_delay << " " <<
                 syn_weight << " " << syn_U << " " <<
                 syn_u << " " << syn_x << " " <<
-                syn_tau_rec << " " << syn_tau_fac << " " << pool;
+                syn_tau_rec << " " << syn_tau_fac << " " << pool << " " << timeline << " " << cost;
 
             std::cout<< "Running command " << command.str() <<std::endl;
             system(command.str().c_str());
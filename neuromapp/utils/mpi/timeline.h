@@ -0,0 +1,181 @@
+/*
+ * Neuromapp - timeline, Copyright (c), 2016,
+ * Timothee Ewart - Swiss Federal Institute of technology in Lausanne,
+ * timothee.ewart@epfl.ch,
+ * All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3.0 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.
+ */
+
+/**
+ * @file neuromapp/utils/mpi/timeline.h
+ * \brief per thread timeline of the phases of a simulation step, dumped in
+ * the Chrome trace format (chrome://tracing, ui.perfetto.dev)
+ */
+
+#ifndef MAPP_TIMELINE_H
+#define MAPP_TIMELINE_H
+
+#include <cstddef>
+#include <algorithm>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <iomanip>
+#include <mpi.h>
+
+#include "utils/omp/compatibility.h"
+
+namespace mapp{
+
+    /** the phases of a time step of the event_passing and nest miniapps */
+    enum phase {send_phase, enqueue_phase, algebra_phase, deliver_phase,
+                exchange_phase, filter_phase, update_phase, nphases};
+
+    inline const char* phase_name(int p){
+        static const char* names[nphases] = {"send", "enqueue", "algebra", "deliver",
+                                             "exchange", "filter", "update"};
+        return names[p];
+    }
+
+    /** a phase of a thread, the times are given by omp_get_wtime */
+    struct timeline_record {
+        explicit timeline_record(int p = 0, double s = 0., double e = 0.):phase_(p),start_(s),end_(e){}
+        int phase_;
+        double start_;
+        double end_;
+    };
+
+    /** ring buffer of the records of a thread: when it is full the oldest
+        records are overwritten, the totals per phase cover the whole run.
+        Padded, every thread writes only its own ring */
+    struct timeline_ring {
+        explicit timeline_ring(std::size_t capacity = 0):records_(capacity),next_(0),count_(0),
+                                                          total_(nphases, 0.){}
+        std::vector<timeline_record> records_;
+        std::size_t next_;
+        std::size_t count_; // number of records since the beginning
+        std::vector<double> total_;
+        char pad_[64];
+    };
+
+    /** the timeline of a rank, one ring per thread */
+    class timeline{
+    public:
+        /** \fn timeline(int nthreads, std::size_t capacity)
+            \brief capacity records per thread (32 bytes each) */
+        explicit timeline(int nthreads, std::size_t capacity = 1 << 16):
+            rings_(nthreads, timeline_ring(capacity)),t0_(omp_get_wtime()){}
+
+        /** \fn record(int thread, int phase, double start, double end)
+            \brief adds a phase of the thread, no lock */
+        inline void record(int thread, int phase, double start, double end){
+            timeline_ring& r = rings_[thread];
+            r.total_[phase] += end - start;
+            if(r.records_.empty())
+                return;
+            r.records_[r.next_] = timeline_record(phase, start, end);
+            if(++r.next_ == r.records_.size())
+                r.next_ = 0;
+            ++r.count_;
+        }
+
+        /** \fn write_chrome(const std::string& file, int rank)
+            \brief writes the records kept in the rings as complete events
+            ("ph":"X") of the process rank, one track per thread, times in us
+            since the creation of the timeline
+            \return false if the file can not be written */
+        bool write_chrome(const std::string& file, int rank) const{
+            std::ofstream out(file.c_str());
+            if(!out)
+                return false;
+            out<<std::fixed<<std::setprecision(3);
+            out<<"{\"traceEvents\":[\n";
+            out<<"{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":"<<rank
+               <<",\"args\":{\"name\":\"rank "<<rank<<"\"}}";
+            for(std::size_t t = 0; t < rings_.size(); ++t){
+                const timeline_ring& r = rings_[t];
+                const std::size_t n = std::min(r.count_, r.records_.size());
+                //the oldest record is at next_ when the ring has wrapped
+                const std::size_t first = (r.count_ > r.records_.size()) ? r.next_ : 0;
+                for(std::size_t i = 0; i < n; ++i){
+                    const timeline_record& e = r.records_[(first + i) % r.records_.size()];
+                    out<<",\n{\"name\":\""<<phase_name(e.phase_)<<"\",\"cat\":\"step\",\"ph\":\"X\",\"ts\":"
+                       <<(e.start_ - t0_)*1.e6<<",\"dur\":"<<(e.end_ - e.start_)*1.e6
+                       <<",\"pid\":"<<rank<<",\"tid\":"<<t<<"}";
+                }
+            }
+            out<<"\n]}\n";
+            return out.good();
+        }
+
+        /** \fn summary(MPI_Comm comm)
+            \brief prints on rank 0 the time of every phase (summed over the
+            threads of a rank): min, mean and max over the ranks, and the
+            imbalance max/mean (collective on comm) */
+        void summary(MPI_Comm comm) const{
+            int rank, size;
+            MPI_Comm_rank(comm, &rank);
+            MPI_Comm_size(comm, &size);
+            std::vector<double> local(nphases, 0.), tmin(nphases), tmax(nphases), tsum(nphases);
+            for(std::size_t t = 0; t < rings_.size(); ++t)
+                for(int p = 0; p < nphases; ++p)
+                    local[p] += rings_[t].total_[p];
+            MPI_Reduce(&local[0], &tmin[0], nphases, MPI_DOUBLE, MPI_MIN, 0, comm);
+            MPI_Reduce(&local[0], &tmax[0], nphases, MPI_DOUBLE, MPI_MAX, 0, comm);
+            MPI_Reduce(&local[0], &tsum[0], nphases, MPI_DOUBLE, MPI_SUM, 0, comm);
+            if(rank == 0){
+                std::cout<<"phase (ms)      min      mean       max  imbalance"<<std::endl;
+                for(int p = 0; p < nphases; ++p){
+                    if(tmax[p] == 0.)
+                        continue;
+                    const double mean = tsum[p]/size;
+                    std::stringstream line;
+                    line<<std::setw(9)<<phase_name(p)<<std::fixed<<std::setprecision(2)
+                        <<std::setw(10)<<tmin[p]*1000.<<std::setw(10)<<mean*1000.
+                        <<std::setw(10)<<tmax[p]*1000.<<std::setw(10)<<tmax[p]/mean;
+                    std::cout<<line.str()<<std::endl;
+                }
+            }
+        }
+
+        /** \fn nthreads()
+            \return the number of rings */
+        inline int nthreads() const { return rings_.size(); }
+
+    private:
+        std::vector<timeline_ring> rings_;
+        double t0_;
+    };
+
+    /** records the phase of the thread from the construction to the
+        destruction, nothing if the timeline is NULL */
+    class timeline_scope{
+    public:
+        timeline_scope(timeline* tl, int thread, int phase):tl_(tl),thread_(thread),phase_(phase),
+                                                             start_(tl ? omp_get_wtime() : 0.){}
+        ~timeline_scope(){
+            if(tl_)
+                tl_->record(thread_, phase_, start_, omp_get_wtime());
+        }
+    private:
+        timeline* tl_;
+        int thread_;
+        int phase_;
+        double start_;
+    };
+} // end namespace
+#endif
@@ -41,6 +41,12 @@ public:
 	 */
 	omp_mutex(){omp_init_lock(&mut_);}
 
+	/** \fn omp_mutex(const omp_mutex&)
+	 *  \brief inits a new mut_, the lock state is never copied (containers
+	 *  of objects with a mutex copy them on resize)
+	 */
+	omp_mutex(const omp_mutex&){omp_init_lock(&mut_);}
+
 	/** \fn ~omp_lock()
 	 *  \brief destroys mut_
 	 */
@@ -55,6 +61,18 @@ public:
 	 *  \brief unsets mut_
 	 */
 	inline void unlock(){omp_unset_lock(&mut_);}
+
+	/** \fn try_lock()
+	 *  \brief sets mut_ if it is free, never waits
+	 *  \return true if mut_ has been set
+	 */
+	inline bool try_lock(){return omp_test_lock(&mut_) != 0;}
+
+	/** \fn operator=(const omp_mutex&)
+	 *  \brief keeps mut_, a lock is not a value (std::vector needs the
+	 *  assignment of its elements)
+	 */
+	omp_mutex& operator=(const omp_mutex&){return *this;}
 };
 
     typedef omp_mutex mutex;
@@ -68,6 +86,7 @@ class dummy_mutex{
 public:
 	void lock(){}
 	void unlock(){}
+	bool try_lock(){return true;}
 };
 
     typedef dummy_mutex mutex;
@@ -30,10 +30,14 @@
 #include <stdlib.h>
 #include <time.h>
 #include <ctime>
+#include <algorithm>
+#include <functional>
 
 #include "coreneuron_1.0/event_passing/environment/generator.h"
 #include "coreneuron_1.0/event_passing/environment/event_generators.hpp"
 #include "coreneuron_1.0/event_passing/environment/presyn_maker.h"
+#include "coreneuron_1.0/event_passing/environment/stream_generator.h"
+#include "coreneuron_1.0/event_passing/environment/counter_rng.h"
 
 /**
  * Test the constructor of presyn_maker class
@@ -94,6 +98,52 @@ BOOST_AUTO_TEST_CASE(presyns_functor_test){
     BOOST_CHECK(valid_input);
 }
 
+/**
+ * Test the CSR presyns with a fixed out degree: every connection is stored
+ * once, on the rank of its target, the input gids are the remote ones
+ */
+BOOST_AUTO_TEST_CASE(presyns_csr_test){
+    const int ncells = 97;
+    const int nprocs = 3;
+    const int fanout = 7;
+    size_t nconnections = 0;
+
+    for(int rank = 0; rank < nprocs; ++rank){
+        environment::continousdistribution neuro_dist(nprocs, rank, ncells);
+        environment::presyn_maker p(fanout, environment::fixedoutdegree);
+        p(rank, &neuro_dist);
+        BOOST_CHECK(p.memory() > 0);
+
+        std::vector<int> inputs;
+        p.input_gids(inputs);
+        for(size_t i = 0; i < inputs.size(); ++i){
+            BOOST_CHECK(!neuro_dist.isLocal(inputs[i]));
+            if(i > 0)
+                BOOST_CHECK(inputs[i-1] < inputs[i]);
+        }
+
+        for(int gid = 0; gid < ncells; ++gid){
+            const environment::presyn* output = p.find_output(gid);
+            const environment::presyn* input = p.find_input(gid);
+            BOOST_CHECK_EQUAL(output != NULL, neuro_dist.isLocal(gid));
+            BOOST_CHECK(!(output && input));
+            const environment::presyn* row = output ? output : input;
+            if(row == NULL)
+                continue;
+            if(input){
+                BOOST_CHECK(!input->empty());
+                BOOST_CHECK(std::binary_search(inputs.begin(), inputs.end(), gid));
+            }
+            for(size_t j = 0; j < row->size(); ++j)
+                BOOST_CHECK(neuro_dist.isLocal((*row)[j]));
+            nconnections += row->size();
+        }
+        BOOST_CHECK(p.find_input(-1) == NULL);
+        BOOST_CHECK(p.find_output(ncells) == NULL);
+    }
+    BOOST_CHECK_EQUAL(nconnections, static_cast<size_t>(ncells*fanout));
+}
+
 /**
  * For a graph with max number of input presyns, test that
  * all gid's that are not in the range [rank, rank + num out) are input presyns.
@@ -381,3 +431,200 @@ BOOST_AUTO_TEST_CASE(generator_compare_top_lte){
     BOOST_CHECK(greater_than_min);
     BOOST_CHECK(less_than_max);
 }
+
+/**
+ * Test the Philox4x32-10 counter based generator against the known answers
+ * of the reference implementation (Random123)
+ */
+BOOST_AUTO_TEST_CASE(counter_rng_known_answers){
+    boost::uint32_t ctr[4] = {0, 0, 0, 0};
+    boost::uint32_t key[2] = {0, 0};
+    boost::uint32_t out[4];
+    environment::philox4x32(ctr, key, out);
+    BOOST_CHECK_EQUAL(out[0], 0x6627e8d5u);
+    BOOST_CHECK_EQUAL(out[1], 0xe169c58du);
+    BOOST_CHECK_EQUAL(out[2], 0xbc57ac4cu);
+    BOOST_CHECK_EQUAL(out[3], 0x9b00dbd8u);
+
+    boost::uint32_t ctr_pi[4] = {0x243f6a88u, 0x85a308d3u, 0x13198a2eu, 0x03707344u};
+    boost::uint32_t key_pi[2] = {0xa4093822u, 0x299f31d0u};
+    environment::philox4x32(ctr_pi, key_pi, out);
+    BOOST_CHECK_EQUAL(out[0], 0xd16cfe09u);
+    BOOST_CHECK_EQUAL(out[1], 0x94fdccebu);
+    BOOST_CHECK_EQUAL(out[2], 0x5001e420u);
+    BOOST_CHECK_EQUAL(out[3], 0x24126ea1u);
+
+    //same triplet, same numbers
+    environment::counter_rng a(1, 2, 3), b(1, 2, 3), c(1, 2, 4);
+    bool same = true, differ = false;
+    for(int i = 0; i < 10; ++i){
+        boost::uint32_t x = a(), z = c();
+        same = same && (x == b());
+        differ = differ || (x != z);
+    }
+    BOOST_CHECK(same);
+    BOOST_CHECK(differ);
+}
+
+/**
+ * Test the stream_generator: the events are valid, only one window is in
+ * memory, and the sequence of a group does not depend on the order in which
+ * the groups are consumed
+ */
+BOOST_AUTO_TEST_CASE(generator_stream){
+    int nspike = 2000;
+    int ncells = 40;
+    int nprocs = 2;
+    int ngroups = 4;
+    int simtime = 100;
+    int window = 5;
+
+    double mean = static_cast<double>(simtime) / static_cast<double>(nspike);
+    double lambda = 1.0 / static_cast<double>(mean * nprocs);
+
+    for(int rank = 0; rank < nprocs; ++rank){
+        environment::continousdistribution neuro_dist(nprocs, rank, ncells);
+        environment::stream_generator by_group(ngroups, simtime, rank, nprocs, lambda, &neuro_dist, window);
+        environment::stream_generator by_step(ngroups, simtime, rank, nprocs, lambda, &neuro_dist, window);
+
+        //group after group, the whole run
+        std::vector<std::vector<environment::gen_event> > first(ngroups), second(ngroups);
+        int max_window = 0;
+        for(int i = 0; i < ngroups; ++i){
+            for(int t = 0; t < simtime; ++t){
+                while(by_group.compare_top_lte(i, t)){
+                    max_window = std::max(max_window, by_group.get_size(i));
+                    first[i].push_back(by_group.pop(i));
+                }
+            }
+        }
+        //time step after time step, the groups in reverse order
+        for(int t = 0; t < simtime; ++t)
+            for(int i = ngroups - 1; i >= 0; --i)
+                while(by_step.compare_top_lte(i, t))
+                    second[i].push_back(by_step.pop(i));
+
+        int total = 0;
+        bool valid = true;
+        for(int i = 0; i < ngroups; ++i){
+            BOOST_CHECK(first[i] == second[i]);
+            total += first[i].size();
+            for(int k = 0; k < first[i].size(); ++k){
+                const environment::gen_event& ev = first[i][k];
+                valid = valid && neuro_dist.isLocal(ev.first) && ev.first % ngroups == i
+                        && ev.second >= 0 && ev.second < simtime
+                        && (k == 0 || first[i][k-1].second <= ev.second);
+            }
+            BOOST_CHECK(!by_group.compare_top_lte(i, 2*simtime));
+        }
+        BOOST_CHECK(valid);
+        //the rate of generate_events_kai on average
+        double expected = simtime*ncells*lambda/nprocs;
+        BOOST_CHECK(total > expected/2);
+        BOOST_CHECK(total < 2*expected);
+        BOOST_CHECK(max_window < total/4);
+    }
+}
+
+/**
+ * Test generate_events_parallel: the queues do not depend on the number of
+ * threads and are the events of the stream_generator
+ */
+BOOST_AUTO_TEST_CASE(generator_parallel){
+    int nspike = 1000;
+    int ncells = 40;
+    int nprocs = 2;
+    int ngroups = 6;
+    int simtime = 100;
+    int rank = 1;
+    int window = 3;
+
+    double mean = static_cast<double>(simtime) / static_cast<double>(nspike);
+    double lambda = 1.0 / static_cast<double>(mean * nprocs);
+    environment::continousdistribution neuro_dist(nprocs, rank, ncells);
+
+    const int threads = omp_get_max_threads();
+    environment::event_generator one(ngroups), many(ngroups);
+    omp_set_num_threads(1);
+    environment::generate_events_parallel(one.begin(), simtime, ngroups, rank, nprocs, lambda, &neuro_dist, window);
+    omp_set_num_threads(std::max(threads, 4));
+    environment::generate_events_parallel(many.begin(), simtime, ngroups, rank, nprocs, lambda, &neuro_dist, window);
+    omp_set_num_threads(threads);
+
+    environment::stream_generator streamer(ngroups, simtime, rank, nprocs, lambda, &neuro_dist, window);
+    for(int i = 0; i < ngroups; ++i){
+        BOOST_CHECK(one.get_size(i) > 0);
+        BOOST_CHECK_EQUAL(one.get_size(i), many.get_size(i));
+        bool same = true;
+        while(!one.empty(i) && !many.empty(i)){
+            environment::gen_event a = one.pop(i);
+            same = same && (a == many.pop(i));
+            same = same && streamer.compare_top_lte(i, simtime) && (a == streamer.pop(i));
+        }
+        BOOST_CHECK(same);
+        BOOST_CHECK(!streamer.compare_top_lte(i, simtime));
+    }
+}
+
+/**
+ * Test weighteddistribution: every cell on one group, the local and global
+ * ids are consistent, the LPT beats the contiguous blocks on a skewed cost,
+ * and the presyns are built on the scattered gids
+ */
+BOOST_AUTO_TEST_CASE(weighted_distribution){
+    const int ncells = 200;
+    const int nprocs = 4;
+    std::vector<double> cost;
+    BOOST_REQUIRE(environment::cell_costs("lognormal", ncells, cost));
+    //the expensive cells first: the contiguous blocks are skewed
+    std::sort(cost.begin(), cost.end(), std::greater<double>());
+    const double contiguous = environment::contiguous_imbalance(nprocs, cost);
+
+    std::vector<int> owners(ncells, 0);
+    double sum = 0., max = 0., imbalance = 0.;
+    for(int rank = 0; rank < nprocs; ++rank){
+        environment::weighteddistribution d(nprocs, rank, cost);
+        BOOST_CHECK_EQUAL(d.getglobalcells(), ncells);
+        for(int i = 0; i < d.getlocalcells(); ++i){
+            const size_t gid = d.local2global(i);
+            BOOST_CHECK(d.isLocal(gid));
+            BOOST_CHECK_EQUAL(d.global2local(gid), i);
+            ++owners[gid];
+        }
+        const double load = environment::local_cost(d, cost);
+        sum += load;
+        max = std::max(max, load);
+        imbalance = d.imbalance();
+    }
+    BOOST_CHECK_CLOSE(imbalance, max*nprocs/sum, 1e-9);
+    BOOST_CHECK_EQUAL(std::count(owners.begin(), owners.end(), 1), ncells);
+    BOOST_CHECK_LT(max*nprocs/sum, contiguous);
+    BOOST_CHECK_LT(max*nprocs/sum, 1.1);
+
+    //threads of a rank, the local cells of the rank only
+    environment::weighteddistribution parent(nprocs, 1, cost);
+    size_t cells = 0;
+    for(int thrd = 0; thrd < 3; ++thrd){
+        environment::neurondistribution* vp = environment::make_distribution(3, thrd, &parent, cost);
+        for(int i = 0; i < vp->getlocalcells(); ++i)
+            BOOST_CHECK(parent.isLocal(vp->local2global(i)));
+        cells += vp->getlocalcells();
+        delete vp;
+    }
+    BOOST_CHECK_EQUAL(cells, parent.getlocalcells());
+
+    environment::presyn_maker p(5, environment::fixedoutdegree);
+    p(1, &parent);
+    for(int i = 0; i < parent.getlocalcells(); ++i)
+        BOOST_CHECK(p.find_input(parent.local2global(i)) == NULL);
+    //the local gids are sparse, the outputs are searched
+    for(int gid = 0; gid < ncells; ++gid)
+        BOOST_CHECK_EQUAL(p.find_output(gid) != NULL, parent.isLocal(gid));
+
+    BOOST_CHECK(!environment::cell_costs("no_such_file", ncells, cost));
+    BOOST_CHECK(environment::make_distribution("no_such_file", nprocs, 0, ncells, cost) == NULL);
+    environment::neurondistribution* d = environment::make_distribution("none", nprocs, 0, ncells, cost);
+    BOOST_CHECK(cost.empty());
+    BOOST_CHECK_EQUAL(d->getlocalcells(), ncells/nprocs);
+    delete d;
+}
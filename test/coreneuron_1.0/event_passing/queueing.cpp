@@ -32,6 +32,7 @@
 #include <sstream>
 #include <iostream>
 #include <fstream>
+#include <iterator>
 
 #include "coreneuron_1.0/event_passing/queueing/queue.h"
 #include "coreneuron_1.0/event_passing/queueing/pool.h"
@@ -166,6 +167,91 @@ BOOST_AUTO_TEST_CASE(thread_deliver){
     BOOST_CHECK(nt.pq_size() == 0);
 }
 
+/*
+ * Unit test for queue::drain_until and queue::push_bulk
+ *
+ *     - for every backend, both paths of drain_until of the heap (pop one
+ *     by one, partition) give the events <= til in time order, the others
+ *     stay in the queue
+ */
+BOOST_AUTO_TEST_CASE(queue_drain_until){
+    std::vector<queueing::event> in;
+    for(int i = 0; i < 1000; ++i)
+        in.push_back(queueing::event(i, (i*37)%1000));
+
+    queueing::queue_type types[] = {queueing::binary_heap, queueing::radix_heap,
+                                    queueing::sptq, queueing::bin, queueing::ladder};
+    for(int j = 0; j < 5; ++j){
+        queueing::queue q(types[j]);
+        q.push_bulk(in.begin(), in.begin() + 10); // push_heap path
+        q.push_bulk(in.begin() + 10, in.end()); // make_heap path
+        BOOST_CHECK(q.size() == 1000);
+
+        std::vector<queueing::event> out;
+        q.drain_until(2.0, std::back_inserter(out)); // few events
+        BOOST_CHECK(out.size() == 3);
+        q.drain_until(600.0, out); // most of them
+        BOOST_CHECK(out.size() == 601);
+        BOOST_CHECK(q.size() == 399);
+        for(size_t i = 0; i < out.size(); ++i)
+            BOOST_CHECK(out[i].t_ == i);
+
+        queueing::event e;
+        BOOST_CHECK(q.atomic_dq(601.0, e));
+        BOOST_CHECK(e.t_ == 601.0);
+
+        queueing::queue copy(q);
+        BOOST_CHECK(copy.size() == 398);
+        BOOST_CHECK(copy.atomic_dq(602.0, e));
+        BOOST_CHECK(e.t_ == 602.0);
+        BOOST_CHECK(q.size() == 398);
+    }
+
+    queueing::queue_type t;
+    BOOST_CHECK(queueing::queue_type_from_string("ladder", t));
+    BOOST_CHECK(t == queueing::ladder);
+    BOOST_CHECK(!queueing::queue_type_from_string("fifo", t));
+}
+
+/*
+ * Unit test for nrn_thread_data::deliver_all function
+ */
+BOOST_AUTO_TEST_CASE(thread_deliver_all){
+    queueing::nrn_thread_data nt;
+    nt.self_send(0,4.0);
+    nt.inter_thread_send(0,1.0);
+    nt.inter_thread_send(0,2.0);
+    nt.enqueue_my_events();
+    nt.self_send(0,3.0);
+
+    nt.increment_time();
+    nt.increment_time();
+    BOOST_CHECK(nt.deliver_all() == 2);
+    BOOST_CHECK(nt.delivered_ == 2);
+    BOOST_CHECK(nt.pq_size() == 2);
+}
+
+/*
+ * Unit test for the trace of nrn_thread_data
+ */
+BOOST_AUTO_TEST_CASE(thread_trace){
+    queueing::nrn_thread_data nt;
+    nt.self_send(0,1.0); // not recorded
+    nt.record(true);
+    nt.self_send(0,2.0);
+    nt.inter_thread_send(0,3.0);
+    nt.enqueue_my_events();
+    nt.increment_time();
+    nt.increment_time();
+    nt.deliver_all();
+
+    const std::vector<tool::trace_record>& t = nt.trace();
+    BOOST_REQUIRE(t.size() == 3);
+    BOOST_CHECK(t[0].op_ == tool::trace_push && t[0].t_ == 2.0);
+    BOOST_CHECK(t[1].op_ == tool::trace_push && t[1].t_ == 3.0);
+    BOOST_CHECK(t[2].op_ == tool::trace_drain && t[2].t_ == 2.0);
+}
+
 /**
  * Unit test for net_receive function
  *
@@ -191,6 +277,46 @@ BOOST_AUTO_TEST_CASE(net_receive){
 }
 
 
+/**
+ * Unit test for the threshold detection of nrn_thread_data
+ *
+ *    - the events delivered raise the voltage of the watched compartment
+ *    - l_algebra detects the crossing, emits one spike and resets the voltage
+ */
+BOOST_AUTO_TEST_CASE(thread_detect){
+    queueing::nrn_thread_data nt;
+    int gid = 7;
+    BOOST_CHECK(!nt.watch(gid, -1));
+    BOOST_CHECK(nt.watch(gid, 0));
+    //the rest is -65 mV in the data, an event is +2 mV
+    nt.set_threshold(-60., 2.);
+
+    //two events, -61 mV: no spike
+    nt.self_send(gid, 0.);
+    nt.self_send(gid, 0.);
+    BOOST_CHECK_EQUAL(nt.deliver_all(), 2);
+    nt.l_algebra();
+    BOOST_CHECK(nt.detected().empty());
+    nt.increment_time();
+
+    //four more events, above the threshold after the decay
+    for(int i = 0; i < 4; ++i)
+        nt.self_send(gid, 1.);
+    BOOST_CHECK_EQUAL(nt.deliver_all(), 4);
+    nt.l_algebra();
+    BOOST_CHECK_EQUAL(nt.detected().size(), 1);
+    BOOST_CHECK_EQUAL(nt.detected()[0].data_, gid);
+    BOOST_CHECK_EQUAL(nt.detected()[0].t_, 1.);
+    BOOST_CHECK_EQUAL(nt.detected_stats_, 1);
+    nt.detected().clear();
+
+    //reset to the rest, no spike without input
+    nt.increment_time();
+    nt.l_algebra();
+    BOOST_CHECK(nt.detected().empty());
+    BOOST_CHECK(nt.compute_time_ > 0.);
+}
+
 //POOL REGRESSION TESTING
 /**
  * Tests the constructor of the pool function
@@ -321,4 +447,201 @@ BOOST_AUTO_TEST_CASE(pool_send_ite){
 
     //check that every event went to the spikeout_ buffer
     BOOST_CHECK(spike.spikeout_.size() == sum_events);
+    BOOST_CHECK(spike.spike_stats_ == sum_events);
+}
+
+/**
+ * Unit test of the lock free ring: capacity, full ring and wrap around
+ */
+BOOST_AUTO_TEST_CASE(ring_push_pop){
+    queueing::spsc_ring<queueing::event> ring(100);
+    BOOST_CHECK_EQUAL(ring.capacity(), 128u);
+    std::vector<queueing::event> out;
+    for(int k = 0; k < 3; ++k){
+        for(int i = 0; i < 128; ++i)
+            BOOST_CHECK(ring.push(queueing::event(i, i*0.5)));
+        BOOST_CHECK(!ring.push(queueing::event(-1, 0.))); // full
+        out.clear();
+        ring.pop_all(std::back_inserter(out));
+        BOOST_REQUIRE_EQUAL(out.size(), 128u);
+        for(int i = 0; i < 128; ++i)
+            BOOST_CHECK_EQUAL(out[i].data_, i);
+        // wrap around
+        for(int i = 0; i < 50; ++i)
+            BOOST_CHECK(ring.push(queueing::event(i, 0.)));
+        out.clear();
+        ring.pop_all(std::back_inserter(out));
+        BOOST_CHECK_EQUAL(out.size(), 50u);
+    }
+}
+
+/**
+ * The spsc rings deliver the same inter thread events than the mutex path
+ */
+BOOST_AUTO_TEST_CASE(pool_send_ite_spsc){
+    int ncells = 10;
+    int fanin = 5;
+    int nprocs = 4;
+    int ngroups = 8;
+    int nspikes = 1000;
+    int mindelay = 5;
+    int simtime = 100;
+    int rank = 0;
+
+    environment::continousdistribution neuro_dist(nprocs, rank, ncells);
+    //fixed seed, the same local connections every run
+    environment::presyn_maker presyns(fanin, environment::fixedoutdegree);
+    presyns(rank, &neuro_dist);
+
+    double mean = static_cast<double>(simtime) / static_cast<double>(nspikes);
+    double lambda = 1.0 / static_cast<double>(mean * nprocs);
+
+    queueing::inter_thread_type ite;
+    BOOST_CHECK(queueing::inter_thread_type_from_string("spsc", ite) && ite == queueing::spsc_ite);
+    BOOST_CHECK(!queueing::inter_thread_type_from_string("lock", ite));
+
+    //generate_events_kai seeds with the time, every run gets a copy of the same events
+    environment::event_generator g0(ngroups);
+    environment::generate_events_kai(g0.begin(),
+                    simtime, ngroups, rank, nprocs, lambda, &neuro_dist);
+
+    int ite_stats[2], local_stats[2];
+    queueing::inter_thread_type types[2] = {queueing::mutex_ite, queueing::spsc_ite};
+    for(int k = 0; k < 2; ++k){
+        spike::spike_interface spike(nprocs);
+        environment::event_generator generator(g0);
+        queueing::pool pl(false, ngroups, mindelay, rank, spike, queueing::binary_heap, types[k]);
+        while(pl.get_time() <= simtime){
+            pl.fixed_step(generator, presyns);
+        }
+        pl.accumulate_stats();
+        ite_stats[k] = spike.ite_stats_;
+        local_stats[k] = spike.local_stats_;
+    }
+    BOOST_CHECK(ite_stats[0] > 0);
+    BOOST_CHECK_EQUAL(ite_stats[0], ite_stats[1]);
+    BOOST_CHECK_EQUAL(local_stats[0], local_stats[1]);
+}
+
+/**
+ * The dynamic and balanced schedules integrate the same events than the
+ * static one, whatever the assignment of the groups to the threads
+ */
+BOOST_AUTO_TEST_CASE(pool_schedule){
+    int ncells = 10;
+    int fanin = 5;
+    int nprocs = 4;
+    int ngroups = 8;
+    int nspikes = 1000;
+    int mindelay = 5;
+    int simtime = 100;
+    int rank = 0;
+
+    environment::continousdistribution neuro_dist(nprocs, rank, ncells);
+    //fixed seed, the same local connections every run
+    environment::presyn_maker presyns(fanin, environment::fixedoutdegree);
+    presyns(rank, &neuro_dist);
+
+    double mean = static_cast<double>(simtime) / static_cast<double>(nspikes);
+    double lambda = 1.0 / static_cast<double>(mean * nprocs);
+
+    queueing::schedule_type schedule;
+    BOOST_CHECK(queueing::schedule_type_from_string("balanced", schedule) && schedule == queueing::balanced_schedule);
+    BOOST_CHECK(!queueing::schedule_type_from_string("guided", schedule));
+
+    //generate_events_kai seeds with the time, every run gets a copy of the same events
+    environment::event_generator g0(ngroups);
+    environment::generate_events_kai(g0.begin(),
+                    simtime, ngroups, rank, nprocs, lambda, &neuro_dist);
+
+    int ite_stats[3], local_stats[3], spikes[3];
+    queueing::schedule_type types[3] = {queueing::static_schedule,
+        queueing::dynamic_schedule, queueing::balanced_schedule};
+    for(int k = 0; k < 3; ++k){
+        spike::spike_interface spike(nprocs);
+        environment::event_generator generator(g0);
+        //rebalance every 2 fixed steps
+        queueing::pool pl(false, ngroups, mindelay, rank, spike,
+                          queueing::binary_heap, queueing::mutex_ite, types[k], 2);
+        while(pl.get_time() <= simtime){
+            pl.fixed_step(generator, presyns);
+            spike.spikeout_.clear();
+        }
+        pl.accumulate_stats();
+        ite_stats[k] = spike.ite_stats_;
+        local_stats[k] = spike.local_stats_;
+        spikes[k] = spike.spike_stats_;
+        for(int t = 0; t < pl.get_nthreads(); ++t){
+            BOOST_CHECK(pl.idle_fraction(t) >= 0.);
+            BOOST_CHECK(pl.idle_fraction(t) <= 1.);
+        }
+    }
+    BOOST_CHECK(ite_stats[0] > 0);
+    for(int k = 1; k < 3; ++k){
+        BOOST_CHECK_EQUAL(ite_stats[0], ite_stats[k]);
+        BOOST_CHECK_EQUAL(local_stats[0], local_stats[k]);
+        BOOST_CHECK_EQUAL(spikes[0], spikes[k]);
+    }
+}
+
+/** counts the spikes given to the exchange by every thread */
+struct counting_exchange : public queueing::thread_exchange {
+    explicit counting_exchange(int nthreads):calls_(nthreads, 0), spikes_(nthreads, 0){}
+    void exchange(int thread, std::vector<queueing::event>& spikes){
+        ++calls_[thread];
+        spikes_[thread] += spikes.size();
+    }
+    std::vector<int> calls_;
+    std::vector<int> spikes_;
+};
+
+/**
+ * test of the per thread exchange of fixed_step: every thread calls it once
+ * per fixed step, with all the spikes, and nothing is left in spikeout_
+ */
+BOOST_AUTO_TEST_CASE(pool_thread_exchange){
+    int ncells = 10;
+    int fanin = 5;
+    int nprocs = 4;
+    int ngroups = 8;
+    int nspikes = 1000;
+    int mindelay = 5;
+    int simtime = 100;
+    int rank = 0;
+
+    environment::continousdistribution neuro_dist(nprocs, rank, ncells);
+    environment::presyn_maker presyns(fanin);
+    presyns(rank, &neuro_dist);
+
+    double mean = static_cast<double>(simtime) / static_cast<double>(nspikes);
+    double lambda = 1.0 / static_cast<double>(mean * nprocs);
+
+    queueing::schedule_type types[3] = {queueing::static_schedule,
+        queueing::dynamic_schedule, queueing::balanced_schedule};
+    for(int k = 0; k < 3; ++k){
+        spike::spike_interface spike(nprocs);
+        environment::event_generator generator(ngroups);
+        environment::generate_events_kai(generator.begin(),
+                        simtime, ngroups, rank, nprocs, lambda, &neuro_dist);
+        int generated = 0;
+        for(int i = 0; i < ngroups; ++i)
+            generated += generator.get_size(i);
+        queueing::pool pl(false, ngroups, mindelay, rank, spike,
+                          queueing::binary_heap, queueing::mutex_ite, types[k], 2);
+        counting_exchange x(pl.get_nthreads());
+        pl.set_thread_exchange(&x);
+        int steps = 0;
+        while(pl.get_time() <= simtime){
+            pl.fixed_step(generator, presyns);
+            BOOST_CHECK(spike.spikeout_.empty());
+            ++steps;
+        }
+        int total = 0;
+        for(int t = 0; t < pl.get_nthreads(); ++t){
+            BOOST_CHECK_EQUAL(x.calls_[t], steps);
+            total += x.spikes_[t];
+        }
+        BOOST_CHECK_EQUAL(total, generated);
+        BOOST_CHECK_EQUAL(spike.spike_stats_, generated);
+    }
 }
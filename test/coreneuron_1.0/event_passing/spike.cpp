@@ -35,6 +35,12 @@
 
 #include "coreneuron_1.0/common/data/helper.h"
 #include "coreneuron_1.0/event_passing/spike/algos.hpp"
+#include "coreneuron_1.0/event_passing/spike/nonblocking.hpp"
+#include "coreneuron_1.0/event_passing/spike/sparse.hpp"
+#include "coreneuron_1.0/event_passing/spike/distributed.hpp"
+#include "coreneuron_1.0/event_passing/spike/hierarchical.hpp"
+#include "coreneuron_1.0/event_passing/spike/network_model.h"
+#include "coreneuron_1.0/event_passing/spike/multiple.hpp"
 #include "coreneuron_1.0/event_passing/spike/spike_interface.h"
 #include "utils/error.h"
 namespace bfs = ::boost::filesystem;
@@ -88,6 +94,277 @@ BOOST_AUTO_TEST_CASE(displ_test){
     }
 }
 
+/**
+ * test the overlapped exchange: the spikes of an interval are in spikein_
+ * after the exchange of the next interval (or after the final wait)
+ */
+BOOST_AUTO_TEST_CASE(nonblocking_spike_exchange){
+    int size;
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+    MPI_Datatype spike = create_spike_type();
+    spike::spike_interface interface(size);
+    nonblocking_exchange nb(MPI_COMM_WORLD, size);
+
+    for(int i = 0; i < 3; ++i)
+        interface.spikeout_.push_back(queueing::event(i, i*0.5));
+    nonblocking_spike(interface, spike, nb);
+    BOOST_CHECK(interface.spikein_.empty());
+    BOOST_CHECK(nb.in_flight_);
+    interface.spikeout_.clear(); // pool::filter
+
+    interface.spikeout_.push_back(queueing::event(7, 1.));
+    nonblocking_spike(interface, spike, nb);
+    BOOST_REQUIRE_EQUAL(interface.spikein_.size(), 3u*size);
+    BOOST_CHECK_EQUAL(interface.spikein_[2].data_, 2);
+    interface.spikein_.clear();
+    interface.spikeout_.clear();
+
+    nonblocking_spike_wait(interface, nb);
+    BOOST_CHECK(!nb.in_flight_);
+    BOOST_REQUIRE_EQUAL(interface.spikein_.size(), 1u*size);
+    BOOST_CHECK_EQUAL(interface.spikein_[0].data_, 7);
+    BOOST_CHECK_EQUAL(nb.exchanges_, 2);
+    MPI_Type_free(&spike);
+}
+
+/**
+ * test the compact wire format: 8 bytes on the wire, exact for integer
+ * time steps, and the same spikes after a compact exchange
+ */
+BOOST_AUTO_TEST_CASE(compact_spike_exchange){
+    int size;
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+    MPI_Datatype compact = create_compact_spike_type();
+    MPI_Datatype spike = create_spike_type();
+    BOOST_CHECK_EQUAL(wire_size(compact), 8);
+    BOOST_CHECK_EQUAL(sizeof(spike::compact_spike), 8u);
+    BOOST_CHECK(wire_size(spike) > wire_size(compact));
+
+    std::vector<queueing::event> in, out;
+    std::vector<spike::compact_spike> wire;
+    for(int i = 0; i < 10; ++i)
+        in.push_back(queueing::event(1000000+i, 3000.+i%3));
+    spike::encode_spikes(in, 3000., wire);
+    spike::decode_spikes(wire, 3000., out);
+    BOOST_REQUIRE_EQUAL(out.size(), in.size());
+    for(int i = 0; i < 10; ++i){
+        BOOST_CHECK_EQUAL(out[i].data_, in[i].data_);
+        BOOST_CHECK_EQUAL(out[i].t_, in[i].t_);
+    }
+
+    spike::spike_interface interface(size);
+    interface.spikeout_ = in;
+    compact_blocking_spike(interface, compact, 3000.);
+    BOOST_REQUIRE_EQUAL(interface.spikein_.size(), in.size()*size);
+    BOOST_CHECK_EQUAL(interface.spikein_[9].data_, in[9].data_);
+    BOOST_CHECK_EQUAL(interface.spikein_[9].t_, in[9].t_);
+    BOOST_CHECK_EQUAL(interface.bytes_on_wire_, 8*in.size()*size);
+    MPI_Type_free(&compact);
+    MPI_Type_free(&spike);
+}
+
+/** input presyns of the gids 2 and 5, for the sparse exchange */
+struct sparse_presyns {
+    void input_gids(std::vector<int>& gids) const {
+        gids.clear();
+        gids.push_back(2);
+        gids.push_back(5);
+    }
+};
+
+/**
+ * test the sparse exchange: only the spikes of the subscribed gids are
+ * sent, to the ranks with the input presyns
+ */
+BOOST_AUTO_TEST_CASE(sparse_spike_exchange){
+    int size, rank;
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Datatype spike = create_spike_type();
+    environment::continousdistribution dist(size, rank, 10*size);
+    sparse_presyns presyns;
+
+    sparse_exchange sx(MPI_COMM_WORLD);
+    sparse_subscribe(sx, presyns, &dist);
+    //every rank subscribes to the gids 2 and 5
+    for(int gid = 0; gid < 10*size; ++gid){
+        std::map<int, std::vector<int> >::const_iterator it = sx.subscribers_.find(gid);
+        if(dist.isLocal(gid) && (gid == 2 || gid == 5)){
+            BOOST_REQUIRE(it != sx.subscribers_.end());
+            BOOST_CHECK_EQUAL(it->second.size(), static_cast<std::size_t>(size));
+        }
+        else{
+            BOOST_CHECK(it == sx.subscribers_.end());
+        }
+    }
+
+    //the owner of 2 and 5 is the source of every rank
+    BOOST_REQUIRE_EQUAL(sx.sources_.size(), 1u);
+    BOOST_CHECK_EQUAL(sx.sources_[0], 0);
+
+    spike::spike_interface interface(size);
+    for(int i = 0; i < 10; ++i){
+        const int gid = dist.local2global(i);
+        interface.spikeout_.push_back(queueing::event(gid, 1.+i));
+    }
+    sparse_spike(interface, spike, sx);
+    //the owner of 2 and 5 sends them to every rank
+    BOOST_REQUIRE_EQUAL(interface.spikein_.size(), 2u);
+    BOOST_CHECK_EQUAL(interface.spikein_[0].data_, 2);
+    BOOST_CHECK_EQUAL(interface.spikein_[0].t_, 3.);
+    BOOST_CHECK_EQUAL(interface.spikein_[1].data_, 5);
+    BOOST_CHECK_EQUAL(interface.spikein_[1].t_, 6.);
+    BOOST_CHECK_EQUAL(sx.spikes_out_, 10);
+    BOOST_CHECK_EQUAL(sx.sent_, rank == 0 ? 2*size : 0);
+    BOOST_CHECK_EQUAL(interface.bytes_on_wire_, 2*wire_size(spike));
+    MPI_Type_free(&spike);
+}
+
+/**
+ * test the distributed graph built by the directory: rank 0 owns the gids
+ * 2 and 5, it sends to every other rank, no self edge
+ */
+BOOST_AUTO_TEST_CASE(create_dist_graph_scalable_test){
+    int size, rank;
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    environment::continousdistribution dist(size, rank, 10*size);
+    sparse_presyns presyns;
+
+    MPI_Comm neighborhood = create_dist_graph_scalable(presyns, &dist);
+    int indegree, outdegree, weighted;
+    MPI_Dist_graph_neighbors_count(neighborhood, &indegree, &outdegree, &weighted);
+    BOOST_CHECK_EQUAL(indegree, rank == 0 ? 0 : 1);
+    BOOST_CHECK_EQUAL(outdegree, rank == 0 ? size - 1 : 0);
+    MPI_Comm_free(&neighborhood);
+}
+
+/**
+ * test the hierarchical exchange: every rank receives the spikes of all the
+ * ranks, for a node per machine, one and two ranks per node, the windows grow
+ */
+BOOST_AUTO_TEST_CASE(hierarchical_spike_exchange){
+    int size, rank;
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Datatype spike = create_spike_type();
+    for(int ranks_per_node = 0; ranks_per_node < 3; ++ranks_per_node){
+        hierarchical_exchange hx(MPI_COMM_WORLD, ranks_per_node);
+        spike::spike_interface interface(size);
+        for(int n = 1; n <= 100; n *= 10){
+            interface.spikeout_.clear();
+            for(int i = 0; i < n; ++i)
+                interface.spikeout_.push_back(queueing::event(rank, i));
+            hierarchical_spike(interface, spike, hx);
+            BOOST_REQUIRE_EQUAL(interface.spikein_.size(), static_cast<std::size_t>(n*size));
+            std::vector<int> per_rank(size);
+            double sum = 0.;
+            for(std::size_t i = 0; i < interface.spikein_.size(); ++i){
+                ++per_rank[interface.spikein_[i].data_];
+                sum += interface.spikein_[i].t_;
+            }
+            BOOST_CHECK_EQUAL(std::count(per_rank.begin(), per_rank.end(), n), size);
+            BOOST_CHECK_EQUAL(sum, size*n*(n-1)/2.);
+        }
+        free_hierarchical_exchange(hx);
+    }
+    MPI_Type_free(&spike);
+}
+
+/**
+ * tests the per thread exchange: the union of the threads is the allgather,
+ * every thread on its own communicator (concurrently if MPI provides
+ * MPI_THREAD_MULTIPLE)
+ */
+BOOST_AUTO_TEST_CASE(multiple_spike_exchange){
+    int size, rank, provided;
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Query_thread(&provided);
+    MPI_Datatype spike = create_spike_type();
+    const int nthreads = 3;
+    {
+        multiple_exchange mx(MPI_COMM_WORLD, nthreads, spike);
+        spike::spike_interface interface(size);
+        //thread t sends t+1 spikes, gid = rank, time = t
+        std::vector<std::vector<queueing::event> > out(nthreads);
+        for(int t = 0; t < nthreads; ++t)
+            out[t].assign(t + 1, queueing::event(rank, t));
+        if(provided == MPI_THREAD_MULTIPLE){
+            #pragma omp parallel for num_threads(nthreads)
+            for(int t = 0; t < nthreads; ++t)
+                mx.exchange(t, out[t]);
+        }
+        else{
+            for(int t = 0; t < nthreads; ++t)
+                mx.exchange(t, out[t]);
+        }
+        multiple_spike(interface, mx);
+        BOOST_REQUIRE_EQUAL(interface.spikein_.size(), static_cast<std::size_t>(6*size));
+        std::vector<int> per_rank(size);
+        double sum = 0.;
+        for(std::size_t i = 0; i < interface.spikein_.size(); ++i){
+            ++per_rank[interface.spikein_[i].data_];
+            sum += interface.spikein_[i].t_;
+        }
+        BOOST_CHECK_EQUAL(std::count(per_rank.begin(), per_rank.end(), 6), size);
+        BOOST_CHECK_EQUAL(sum, 8.*size); // 0 + 2*1 + 3*2
+        BOOST_CHECK_EQUAL(interface.bytes_on_wire_, 6LL*size*wire_size(spike));
+        multiple_spike(interface, mx);
+        BOOST_CHECK_EQUAL(interface.spikein_.size(), static_cast<std::size_t>(6*size));
+        free_multiple_exchange(mx);
+    }
+    MPI_Type_free(&spike);
+}
+
+/**
+ * tests the network model replay: the costs of the algorithms for known
+ * sizes, weak against strong scaling and the collector files
+ */
+BOOST_AUTO_TEST_CASE(network_model_replay){
+    spike::network_model net; // alpha-beta, 1.5 us, 1e-10 s/byte
+    spike::exchange_scaling s; // 12 bytes per spike
+    const double msg = 2*1.5e-6 + (4 + 1200)*1e-10; // counts + 100 spikes
+    BOOST_CHECK_CLOSE(spike::exchange_time(net, spike::allgather_ring, 8, 100., 100., s), 7*msg, 1e-9);
+    BOOST_CHECK_CLOSE(spike::exchange_time(net, spike::allgather_doubling, 8, 100., 100., s),
+                      3*2*1.5e-6 + 7*(4 + 1200)*1e-10, 1e-9);
+    BOOST_CHECK_EQUAL(spike::exchange_time(net, spike::alltoallv_pairwise, 1, 100., 100., s), 0.);
+    //the ring waits for the busiest rank, recursive doubling moves the mean
+    BOOST_CHECK_GT(spike::exchange_time(net, spike::allgather_ring, 8, 100., 400., s),
+                   spike::exchange_time(net, spike::allgather_ring, 8, 100., 100., s));
+    BOOST_CHECK_EQUAL(spike::exchange_time(net, spike::allgather_doubling, 8, 100., 400., s),
+                      spike::exchange_time(net, spike::allgather_doubling, 8, 100., 100., s));
+
+    //LogGP: a burst overlaps the latencies
+    net.kind_ = spike::network_model::loggp;
+    BOOST_CHECK_EQUAL(net.burst(1, 1200.), net.message(1200.));
+    BOOST_CHECK_CLOSE(net.burst(3, 1.), net.message(1.) + 2*0.6e-6, 1e-9);
+    BOOST_CHECK_LT(net.burst(3, 1200.), 3*net.message(1200.));
+    net.kind_ = spike::network_model::alpha_beta;
+
+    bfs::path sum = bfs::temp_directory_path() / bfs::unique_path();
+    bfs::path max = bfs::temp_directory_path() / bfs::unique_path();
+    std::ofstream(sum.c_str()) << "800\n1600\n";
+    std::ofstream(max.c_str()) << "100\n400\n";
+    std::vector<spike::exchange_step> steps;
+    BOOST_REQUIRE(spike::read_steps(sum.string(), max.string(), steps));
+    BOOST_REQUIRE_EQUAL(steps.size(), 2);
+    BOOST_CHECK_EQUAL(steps[1].total_, 1600.);
+    BOOST_CHECK_EQUAL(steps[1].max_, 400.);
+    BOOST_CHECK(!spike::read_steps(sum.string(), sum.string() + "_none", steps));
+    bfs::remove(sum);
+    bfs::remove(max);
+
+    //8 ranks measured, 100 spikes per rank at step 0
+    s.nprocs_ = 8;
+    std::vector<double> weak = spike::replay(net, spike::allgather_ring, steps, 16, s);
+    BOOST_CHECK_CLOSE(weak[0], 15*msg, 1e-9);
+    BOOST_CHECK_GT(weak[1], weak[0]);
+    s.weak_ = false;
+    std::vector<double> strong = spike::replay(net, spike::allgather_ring, steps, 16, s);
+    BOOST_CHECK_CLOSE(strong[0], 15*(2*1.5e-6 + (4 + 600)*1e-10), 1e-9);
+}
+
 /**
  * for queueing::pool and spike::environment
  * test that run sim function results in the expected end state
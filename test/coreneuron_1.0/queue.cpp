@@ -27,16 +27,27 @@
 #define BOOST_TEST_MODULE QueueTEST
 
 #include <numeric>
+#include <queue>
 #include <iostream>
 #include <fstream>
 #include <algorithm>
+#include <set>
+#include <map>
+#include <cstdio>
 
 #include <boost/mpl/list.hpp>
 #include <boost/test/unit_test.hpp>
 #include <boost/array.hpp>
+#include <boost/type_traits/is_same.hpp>
+#include <boost/random/mersenne_twister.hpp>
+#include <boost/random/uniform_real_distribution.hpp>
+#include <boost/random/uniform_int_distribution.hpp>
 
 #include "coreneuron_1.0/queue/queue.h"
 #include "coreneuron_1.0/queue/tool/priority_queue.hpp"
+#include "coreneuron_1.0/queue/tool/trace.h"
+#include "coreneuron_1.0/queue/histogram.h"
+#include "coreneuron_1.0/queue/concurrent_benchmark.h"
 #include "coreneuron_1.0/common/data/helper.h" // common functionalities
 #include "utils/error.h"
 
@@ -46,17 +57,33 @@ typedef boost::mpl::list<tool::sptq_queue<int,std::greater<int> >,
                          tool::sptq_queue<double,std::greater<double> >,
                          tool::bin_queue<int>,
                          tool::bin_queue<float>,
-                         tool::bin_queue<double> > full_test_types;
+                         tool::bin_queue<double>,
+                         tool::sptq_queue<double,std::greater<double>,tool::new_allocator<tool::sptq_node<double> > >,
+                         tool::bin_queue<double,tool::new_allocator<tool::bin_node<double> > > > full_test_types;
+
+//queues with the std API only, no node so no move
+typedef boost::mpl::list<tool::sptq_queue<int,std::greater<int> >,
+                         tool::sptq_queue<float,std::greater<float> >,
+                         tool::sptq_queue<double,std::greater<double> >,
+                         tool::bin_queue<int>,
+                         tool::bin_queue<float>,
+                         tool::bin_queue<double>,
+                         tool::ladder_queue<int>,
+                         tool::ladder_queue<float>,
+                         tool::ladder_queue<double>,
+                         tool::radix_queue<int>,
+                         tool::radix_queue<float>,
+                         tool::radix_queue<double> > api_test_types;
 
 
-BOOST_AUTO_TEST_CASE_TEMPLATE(constructor,T,full_test_types) {
+BOOST_AUTO_TEST_CASE_TEMPLATE(constructor,T,api_test_types) {
     typedef T value_type;
     value_type queue;
     BOOST_CHECK_EQUAL(queue.size(),0.);
     BOOST_CHECK_EQUAL(queue.top(),0.);
 }
 
-BOOST_AUTO_TEST_CASE_TEMPLATE(push_pop,T,full_test_types) {
+BOOST_AUTO_TEST_CASE_TEMPLATE(push_pop,T,api_test_types) {
     typedef T value_type;
     value_type queue;
     queue.push(1);
@@ -88,7 +115,7 @@ BOOST_AUTO_TEST_CASE(push_pop_random_less) {
     }
 }
 
-BOOST_AUTO_TEST_CASE_TEMPLATE(push_pop_random_greater,T,full_test_types) {
+BOOST_AUTO_TEST_CASE_TEMPLATE(push_pop_random_greater,T,api_test_types) {
     typedef T value_type;
     typedef typename T::value_type nested_value_type;
 
@@ -142,6 +169,307 @@ BOOST_AUTO_TEST_CASE_TEMPLATE(remove_greater,T,full_test_types) {
     BOOST_CHECK_EQUAL(queue.size(), 11);
   }
 
+BOOST_AUTO_TEST_CASE_TEMPLATE(copy_queue,T,full_test_types) {
+    T queue;
+    for(int i = 0; i < 100; ++i)
+        queue.push((i*37)%100);
+    T copy(queue);
+    T assigned;
+    assigned.push(5);
+    assigned = queue;
+    for(int i = 0; i < 100; ++i){
+        BOOST_REQUIRE_EQUAL(copy.top(), queue.top());
+        BOOST_REQUIRE_EQUAL(assigned.top(), queue.top());
+        queue.pop();
+        copy.pop();
+        assigned.pop();
+    }
+    BOOST_CHECK(copy.empty());
+    BOOST_CHECK(assigned.empty());
+}
+
+BOOST_AUTO_TEST_CASE(pool_allocator_reuse){
+    typedef tool::bin_node<double> node_type;
+    tool::pool_allocator<node_type> pool(4); // small slab to cross several slabs
+    std::vector<node_type*> v;
+    for(int i = 0; i < 100; ++i){
+        v.push_back(pool.allocate(i));
+        BOOST_CHECK_EQUAL(v.back()->t_, i);
+    }
+    std::vector<node_type*> w(v);
+    std::sort(w.begin(),w.end());
+    BOOST_CHECK(std::unique(w.begin(),w.end()) == w.end()); // all different
+
+    for(int i = 0; i < 100; ++i)
+        pool.deallocate(v[i]);
+    // the free list gives back the same nodes, last freed first
+    for(int i = 99; i >= 0; --i)
+        BOOST_CHECK(pool.allocate(0.) == v[i]);
+}
+
+BOOST_AUTO_TEST_CASE(ladder_vs_std){
+    // mh_bench like workload, large enough to build several rungs
+    std::priority_queue<double,std::vector<double>,std::greater<double> > ref;
+    tool::ladder_queue<double> q;
+    boost::random::mt19937 generator;
+    boost::random::uniform_real_distribution<double> distribution(0.5,2.0);
+
+    for(double t = 0.0; t < 20.0; t += 0.025){
+        for(int i = 0; i < 500; ++i){
+            double value = t + distribution(generator);
+            ref.push(value);
+            q.push(value);
+        }
+        while(!ref.empty() && ref.top() <= t){
+            BOOST_REQUIRE_EQUAL(q.top(),ref.top());
+            q.pop();
+            ref.pop();
+        }
+        BOOST_REQUIRE_EQUAL(q.size(),ref.size());
+    }
+
+    while(!ref.empty()){
+        BOOST_REQUIRE_EQUAL(q.top(),ref.top());
+        q.pop();
+        ref.pop();
+    }
+    BOOST_CHECK(q.empty());
+}
+
+BOOST_AUTO_TEST_CASE(ladder_non_monotone){
+    // pushes below the top (self_send at the current time of event_passing)
+    // interleaved with pops and drains, they go below the bottom or the epoch
+    boost::random::uniform_int_distribution<int> op(0,9);
+    boost::random::uniform_real_distribution<double> ahead(0.,5.);
+    boost::random::uniform_real_distribution<double> behind(0.,1.);
+    for(unsigned int seed = 1; seed <= 20; ++seed){
+        std::priority_queue<double,std::vector<double>,std::greater<double> > ref;
+        tool::ladder_queue<double> q;
+        boost::random::mt19937 generator(seed);
+        std::vector<double> out;
+        double now = 0.;
+        for(int i = 0; i < 5000; ++i){
+            const int o = op(generator);
+            if(o < 4 || ref.empty()){
+                double value = now + ahead(generator);
+                ref.push(value);
+                q.push(value);
+            }else if(o < 7){
+                // at or below the top, never below the last pop
+                double value = ref.top() - behind(generator)*(ref.top() - now);
+                ref.push(value);
+                q.push(value);
+            }else if(o < 9){
+                BOOST_REQUIRE_EQUAL(q.top(),ref.top());
+                now = ref.top();
+                q.pop();
+                ref.pop();
+            }else{
+                now += behind(generator);
+                out.clear();
+                tool::drain_until(q, now, std::back_inserter(out));
+                for(std::size_t j = 0; j < out.size(); ++j){
+                    BOOST_REQUIRE(!ref.empty());
+                    BOOST_REQUIRE_EQUAL(out[j],ref.top());
+                    ref.pop();
+                }
+                BOOST_REQUIRE(ref.empty() || ref.top() > now);
+            }
+            BOOST_REQUIRE_EQUAL(q.size(),ref.size());
+        }
+        while(!ref.empty()){
+            BOOST_REQUIRE_EQUAL(q.top(),ref.top());
+            q.pop();
+            ref.pop();
+        }
+        BOOST_CHECK(q.empty());
+    }
+}
+
+BOOST_AUTO_TEST_CASE(bin_sparse_cancel){
+    // times on the dt grid, so a bin holds a single time and the order is total,
+    // the moved nodes use odd bins, one node per bin, to know which one is popped
+    typedef tool::bin_node<double> node_type;
+    const double dt = 0.025;
+    std::multiset<int> ref;
+    std::map<int,node_type*> nodes;
+    tool::bin_queue<double,tool::new_allocator<node_type> > q(dt);
+    boost::random::mt19937 generator;
+    boost::random::uniform_int_distribution<int> near(1,64);
+    boost::random::uniform_int_distribution<int> far(1,100000); // larger than the ring
+
+    int k = 0;
+    for(int step = 0; step < 5000; ++step){
+        int b = k + ((step % 10) ? near(generator) : far(generator));
+        if(step % 3){
+            b += b & 1;
+            q.push(b*dt);
+            ref.insert(b);
+        }else{
+            b |= 1;
+            if(nodes.find(b) == nodes.end()){
+                nodes[b] = new node_type(b*dt);
+                q.push(nodes[b]);
+                ref.insert(b);
+            }
+        }
+        // cancel a node
+        if(step % 7 == 0 && !nodes.empty()){
+            std::map<int,node_type*>::iterator it = nodes.begin();
+            std::advance(it, step % nodes.size());
+            ref.erase(ref.find(it->first));
+            delete q.find(it->second);
+            nodes.erase(it);
+        }
+        BOOST_REQUIRE_EQUAL(q.size(),ref.size());
+        // deliver a few
+        for(int i = 0; i < 2 && !ref.empty(); ++i){
+            k = *ref.begin();
+            BOOST_REQUIRE_EQUAL(static_cast<int>(q.top()/dt + 0.5),k);
+            ref.erase(ref.begin());
+            nodes.erase(k); // deleted by the queue
+            q.pop();
+        }
+    }
+    while(!ref.empty()){
+        BOOST_REQUIRE_EQUAL(static_cast<int>(q.top()/dt + 0.5),*ref.begin());
+        ref.erase(ref.begin());
+        q.pop();
+    }
+    BOOST_CHECK(q.empty());
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(drain_until_vs_std,T,api_test_types) {
+    typedef typename T::value_type value_type;
+    std::priority_queue<value_type,std::vector<value_type>,std::greater<value_type> > ref;
+    T q;
+    boost::random::mt19937 generator;
+    boost::random::uniform_real_distribution<double> distribution(0.5,20.0);
+    std::vector<value_type> in(200), out, out_ref;
+
+    for(double t = 0.0; t < 50.0; t += 0.5){
+        for(std::size_t i = 0; i < in.size(); ++i)
+            in[i] = static_cast<value_type>(t + distribution(generator));
+        tool::push_bulk(q, in.begin(), in.end());
+        tool::push_bulk(ref, in.begin(), in.end());
+
+        out.clear();
+        out_ref.clear();
+        tool::drain_until(q, static_cast<value_type>(t), std::back_inserter(out));
+        tool::drain_until(ref, static_cast<value_type>(t), std::back_inserter(out_ref));
+        std::sort(out.begin(), out.end()); // no order into a bin of the bin_queue
+        BOOST_REQUIRE_EQUAL(out.size(), out_ref.size());
+        BOOST_REQUIRE(std::equal(out.begin(), out.end(), out_ref.begin()));
+        BOOST_REQUIRE_EQUAL(q.size(), ref.size());
+    }
+}
+
+BOOST_AUTO_TEST_CASE(radix_key_order){
+    double a[] = {-3.5, -1., -0., 0., 1e-300, 0.025, 1., 2., 1e300};
+    for(int i = 1; i < 9; ++i)
+        BOOST_CHECK(tool::radix_queue<double>::key(a[i-1]) < tool::radix_queue<double>::key(a[i]));
+}
+
+BOOST_AUTO_TEST_CASE(radix_late_event){
+    // an event earlier than the last pop is due now
+    tool::radix_queue<double> q;
+    q.push(2.);
+    q.push(5.);
+    q.pop();
+    q.push(1.);
+    BOOST_CHECK_EQUAL(q.top(), 1.);
+    q.pop();
+    BOOST_CHECK_EQUAL(q.top(), 5.);
+}
+
+BOOST_AUTO_TEST_CASE(radix_peek_then_earlier_push){
+    // a drain which stops early looks at 7 without popping it, 6 is not late
+    tool::radix_queue<double> q;
+    std::vector<double> out;
+    q.push(7.);
+    tool::drain_until(q, 5., std::back_inserter(out));
+    BOOST_CHECK(out.empty());
+    q.push(6.);
+    tool::drain_until(q, 6., std::back_inserter(out));
+    BOOST_REQUIRE_EQUAL(out.size(), 1u);
+    BOOST_CHECK_EQUAL(out[0], 6.);
+    BOOST_CHECK_EQUAL(q.top(), 7.); // top does not pop either
+    q.push(6.5);
+    BOOST_CHECK_EQUAL(q.top(), 6.5);
+    q.pop();
+    BOOST_CHECK_EQUAL(q.top(), 7.);
+    q.pop();
+    BOOST_CHECK(q.empty());
+}
+
+BOOST_AUTO_TEST_CASE(trace_write_read){
+    std::vector<tool::trace_record> records, read;
+    for(int i = 0; i < 100; ++i)
+        records.push_back(tool::trace_record((i%3) ? tool::trace_push : tool::trace_drain, i*0.5));
+    BOOST_CHECK(tool::write_trace("queue_test.trace", records));
+    BOOST_CHECK(tool::read_trace("queue_test.trace", read));
+    BOOST_REQUIRE_EQUAL(read.size(), records.size());
+    for(std::size_t i = 0; i < read.size(); ++i){
+        BOOST_CHECK_EQUAL(read[i].op_, records[i].op_);
+        BOOST_CHECK_EQUAL(read[i].t_, records[i].t_);
+    }
+    std::remove("queue_test.trace");
+    BOOST_CHECK(!tool::read_trace("queue_test.trace", read));
+}
+
+BOOST_AUTO_TEST_CASE(latency_histogram_percentile){
+    queue::latency_histogram h;
+    BOOST_CHECK_EQUAL(h.percentile(50.), 0u);
+    for(unsigned long long int i = 1; i <= 10000; ++i)
+        h.record(i);
+    BOOST_CHECK_EQUAL(h.count(), 10000u);
+    BOOST_CHECK_EQUAL(h.max(), 10000u);
+    BOOST_CHECK_EQUAL(h.percentile(0.1), 10u); // exact below 32
+    // 32 sub buckets per power of 2, lower bound of the bucket within 1/32
+    BOOST_CHECK(h.percentile(50.) <= 5000u && h.percentile(50.) >= 5000u - 5000u/32);
+    BOOST_CHECK(h.percentile(99.) <= 9900u && h.percentile(99.) >= 9900u - 9900u/32);
+    BOOST_CHECK_EQUAL(h.percentile(100.), h.max());
+}
+
+typedef boost::mpl::list<queue::mutex_heap, queue::multi_queue, queue::sorted_runs> concurrent_test_types;
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(concurrent_drain,T,concurrent_test_types) {
+    boost::random::mt19937 generator;
+    boost::random::uniform_real_distribution<double> distribution(0.0,10.0);
+    T* q = queue::make_target<T>(3);
+    std::vector<double> ref, out;
+    for(int i = 0; i < 999; ++i){
+        double t = distribution(generator);
+        q->push(i%3, t);
+        ref.push_back(t);
+    }
+    for(int i = 0; i < 3; ++i)
+        q->flush(i);
+    std::sort(ref.begin(), ref.end());
+
+    q->drain_until(5., std::back_inserter(out));
+    q->drain_until(10., std::back_inserter(out));
+    delete q;
+    BOOST_REQUIRE_EQUAL(out.size(), ref.size());
+    std::vector<double> sorted(out);
+    std::sort(sorted.begin(), sorted.end());
+    BOOST_CHECK(sorted == ref);
+    // every drain is complete, the order is relaxed only for the multi_queue
+    std::size_t n = std::upper_bound(ref.begin(), ref.end(), 5.) - ref.begin();
+    BOOST_CHECK(*std::max_element(out.begin(), out.begin()+n) <= 5.);
+    if(!boost::is_same<T, queue::multi_queue>::value)
+        BOOST_CHECK(out == ref);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(concurrent_helper_delivered,T,concurrent_test_types) {
+    queue::concurrent_result one = queue::concurrent_helper<T>::benchmark(16, 2, queue::one_target, 2.);
+    queue::concurrent_result all = queue::concurrent_helper<T>::benchmark(16, 2, queue::all_targets, 2.);
+    BOOST_CHECK_EQUAL(one.events, 2u*16u*80u);
+    BOOST_CHECK(one.delivered > 0 && one.delivered <= one.events);
+    BOOST_CHECK_EQUAL(all.events, one.events);
+    BOOST_CHECK(all.delivered > 0 && all.delivered <= all.events);
+}
+
 BOOST_AUTO_TEST_CASE(helper_solver_test){
     std::vector<std::string> command_v;
     int error(mapp::MAPP_OK);
@@ -187,6 +515,8 @@ BOOST_AUTO_TEST_CASE(helper_solver_test){
     BOOST_CHECK(error==mapp::MAPP_OK);
     std::ifstream file("pop.csv");
     BOOST_CHECK((bool)file==true);
+    std::ifstream json("pop.json");
+    BOOST_CHECK((bool)json==true);
 
 
     command_v.clear();
@@ -0,0 +1,76 @@
+/*
+ * Neuromapp - timeline.cpp, Copyright (c), 2016,
+ * Timothee Ewart - Swiss Federal Institute of technology in Lausanne,
+ * timothee.ewart@epfl.ch
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.
+ */
+
+/**
+ * @file neuromapp/test/utils/timeline.cpp
+ *  Test the timeline of the phases
+ */
+
+#define BOOST_TEST_MODULE TIMELINE_TEST
+
+#include <boost/test/unit_test.hpp>
+#include <sstream>
+#include <fstream>
+#include <string>
+#include <cstdio>
+#include "utils/mpi/timeline.h"
+
+//Performs MPI init/finalize
+#include "test/tools/mpi_helper.h"
+
+/**
+ * The ring keeps the last records, the totals cover every record
+ */
+BOOST_AUTO_TEST_CASE(timeline_ring_test){
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    mapp::timeline tl(2, 4);
+    for(int i = 0; i < 10; ++i)
+        tl.record(1, mapp::deliver_phase, i, i + 0.5);
+    tl.record(0, mapp::exchange_phase, 0., 1.);
+    {
+        mapp::timeline_scope scope(&tl, 0, mapp::filter_phase);
+    }
+    mapp::timeline_scope nothing(NULL, 0, mapp::filter_phase);
+
+    std::stringstream file;
+    file << "timeline_test_" << rank << ".json";
+    BOOST_CHECK(tl.write_chrome(file.str(), rank));
+
+    std::ifstream in(file.str().c_str());
+    std::string json((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    in.close();
+    std::remove(file.str().c_str());
+
+    //4 records of thread 1 (the last ones), 2 of thread 0
+    int deliver = 0, pos = 0;
+    while((pos = json.find("\"deliver\"", pos) + 1) > 0)
+        ++deliver;
+    BOOST_CHECK_EQUAL(deliver, 4);
+    BOOST_CHECK(json.find("\"exchange\"") != std::string::npos);
+    BOOST_CHECK(json.find("\"filter\"") != std::string::npos);
+    BOOST_CHECK(json.find("\"tid\":1") != std::string::npos);
+    //the tracks are written thread after thread
+    BOOST_CHECK(json.find("\"deliver\"") > json.find("\"exchange\""));
+    BOOST_CHECK(json.rfind("\"ph\":\"X\"") != std::string::npos);
+
+    //collective, the summary is printed on rank 0
+    tl.summary(MPI_COMM_WORLD);
+}